@@ -0,0 +1,175 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <stdint.h>
+#include <stdexcept>
+#include "../../Core/Math/Vector.h"
+#include "../../Core/Math/Matrix.h"
+#include "../../Core/Utilities/MathFunctions.h"
+
+
+// Before and after for the math changes, in ns per vertex: every loop runs once through today's Vector and Matrix
+// and once through Eager, a copy of the operators and element access as they were before. Those filled a zeroed
+// Vector for each step, subtracted by adding the negation and checked every index, even in release builds.
+// Both versions have to produce the same checksum, the expressions round every step like the eager code did
+
+using Vector3F = Vector<float, 3>;
+using Vector4F = Vector<float, 4>;
+using Matrix4x4F = Matrix<float, 4, 4>;
+
+constexpr size_t vertexCount = 100000;
+constexpr int repetitions = 200;
+
+namespace Eager {
+    inline float At(const Vector3F& vector, int index) {
+        if (index >= 3) throw std::out_of_range("Index out of range");
+        return vector.components[index];
+    }
+
+    inline float At(const Matrix4x4F& matrix, int row, int column) {
+        if (row >= 4) throw std::out_of_range("Row index out of range");
+        if (column >= 4) throw std::out_of_range("Column index out of range");
+        return matrix.elements[row * 4 + column];
+    }
+
+    inline Vector3F Add(const Vector3F& left, const Vector3F& right) {
+        Vector3F temp;
+        for (int i = 0; i < 3; i++) temp.components[i] = left.components[i] + right.components[i];
+        return temp;
+    }
+
+    inline Vector3F Negate(const Vector3F& vector) {
+        Vector3F temp;
+        for (int i = 0; i < 3; i++) temp.components[i] = -vector.components[i];
+        return temp;
+    }
+
+    inline Vector3F Subtract(const Vector3F& left, const Vector3F& right) {
+        return Add(left, Negate(right));
+    }
+
+    inline Vector3F Scale(const Vector3F& vector, float scalar) {
+        Vector3F temp;
+        for (int i = 0; i < 3; i++) temp.components[i] = vector.components[i] * scalar;
+        return temp;
+    }
+
+    inline Vector3F Divide(const Vector3F& vector, float scalar) {
+        Vector3F temp;
+        for (int i = 0; i < 3; i++) temp.components[i] = vector.components[i] / scalar;
+        return temp;
+    }
+}
+
+// a + (b - a) * t, Renderer2D's edge interpolation
+__attribute__((noinline)) void Lerp(const std::vector<Vector3F>& a, const std::vector<Vector3F>& b, float t, std::vector<Vector3F>& output) {
+    for (size_t i = 0; i < a.size(); i++) output[i] = a[i] + (b[i] - a[i]) * t;
+}
+
+__attribute__((noinline)) void LerpEager(const std::vector<Vector3F>& a, const std::vector<Vector3F>& b, float t, std::vector<Vector3F>& output) {
+    for (size_t i = 0; i < a.size(); i++) output[i] = Eager::Add(a[i], Eager::Scale(Eager::Subtract(b[i], a[i]), t));
+}
+
+__attribute__((noinline)) void Chain(const std::vector<Vector3F>& a, const std::vector<Vector3F>& b, std::vector<Vector3F>& output) {
+    for (size_t i = 0; i < a.size(); i++) output[i] = (a[i] + b[i]) * 0.5f - (a[i] - b[i]) / 4.0f + output[i];
+}
+
+__attribute__((noinline)) void ChainEager(const std::vector<Vector3F>& a, const std::vector<Vector3F>& b, std::vector<Vector3F>& output) {
+    for (size_t i = 0; i < a.size(); i++) {
+        output[i] = Eager::Add(Eager::Subtract(Eager::Scale(Eager::Add(a[i], b[i]), 0.5f), Eager::Divide(Eager::Subtract(a[i], b[i]), 4.0f)), output[i]);
+    }
+}
+
+// the transform loop written with element access: matrix * (x, y, z, 1) and the divide
+__attribute__((noinline)) void TransformPoints(const std::vector<Vector3F>& points, const Matrix4x4F& matrix, std::vector<Vector3F>& output) {
+    for (size_t i = 0; i < points.size(); i++) {
+        const Vector3F& point = points[i];
+        float clip[4];
+        for (int row = 0; row < 4; row++) {
+            clip[row] = matrix(row, 0) * point[0] + matrix(row, 1) * point[1] + matrix(row, 2) * point[2] + matrix(row, 3);
+        }
+        output[i] = Vector3F(clip[0] / clip[3], clip[1] / clip[3], clip[2] / clip[3]);
+    }
+}
+
+__attribute__((noinline)) void TransformPointsEager(const std::vector<Vector3F>& points, const Matrix4x4F& matrix, std::vector<Vector3F>& output) {
+    for (size_t i = 0; i < points.size(); i++) {
+        const Vector3F& point = points[i];
+        float clip[4];
+        for (int row = 0; row < 4; row++) {
+            clip[row] = Eager::At(matrix, row, 0) * Eager::At(point, 0) + Eager::At(matrix, row, 1) * Eager::At(point, 1) +
+                        Eager::At(matrix, row, 2) * Eager::At(point, 2) + Eager::At(matrix, row, 3);
+        }
+        output[i] = Vector3F(clip[0] / clip[3], clip[1] / clip[3], clip[2] / clip[3]);
+    }
+}
+
+// the same through the SSE vector * matrix product
+__attribute__((noinline)) void TransformPointsSIMD(const std::vector<Vector3F>& points, const Matrix4x4F& matrix, std::vector<Vector3F>& output) {
+    for (size_t i = 0; i < points.size(); i++) {
+        const Vector3F& point = points[i];
+        Vector4F clip = Vector4F(point[0], point[1], point[2], 1.0f) * matrix;
+        output[i] = Vector3F(clip[0] / clip[3], clip[1] / clip[3], clip[2] / clip[3]);
+    }
+}
+
+
+template <typename Loop>
+double NanosecondsPerVertex(Loop loop) {
+    loop();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repetitions; i++) loop();
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / repetitions / vertexCount;
+}
+
+double Checksum(const std::vector<Vector3F>& points) {
+    double sum = 0.0;
+    for (const Vector3F& point : points) sum += point[0] + point[1] + point[2];
+    return sum;
+}
+
+int main() {
+    // xorshift, the same points every run
+    uint32_t state = 1;
+    auto random = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return (state >> 8) * (10.0f / 16777216.0f) - 5.0f;
+    };
+
+    std::vector<Vector3F> a(vertexCount), b(vertexCount);
+    for (Vector3F& point : a) point = Vector3F(random(), random(), random());
+    for (Vector3F& point : b) point = Vector3F(random(), random(), random());
+    const Matrix4x4F matrix = MathFunctions::Matrices::CreateTranslationMatrix(1.0f, 2.0f, 10.0f) *
+                              MathFunctions::Matrices::CreateRotationMatrix(0.3f, 0.2f, 0.1f);
+
+#ifdef MATH_BOUNDS_CHECKS
+    std::cout<<"bounds checks compiled in, build with -DNDEBUG for the release numbers"<<std::endl;
+#endif
+    std::cout<<std::fixed<<std::setprecision(2);
+    std::vector<Vector3F> before(vertexCount), after(vertexCount);
+    auto report = [&](const char* name, double eager, double current) {
+        std::cout<<name<<eager<<" -> "<<current<<" ns, checksums "<<(Checksum(before) == Checksum(after) ? "match" : "DIFFER")<<std::endl;
+    };
+
+    double lerpEager = NanosecondsPerVertex([&]() { LerpEager(a, b, 0.3f, before); });
+    double lerp = NanosecondsPerVertex([&]() { Lerp(a, b, 0.3f, after); });
+    report("lerp a + (b - a) * t:            ", lerpEager, lerp);
+
+    // both start from the same output, the loop adds to it
+    before = a;
+    after = a;
+    double chainEager = NanosecondsPerVertex([&]() { ChainEager(a, b, before); });
+    double chain = NanosecondsPerVertex([&]() { Chain(a, b, after); });
+    report("(a + b) * 0.5 - (a - b) / 4 + c: ", chainEager, chain);
+
+    double transformEager = NanosecondsPerVertex([&]() { TransformPointsEager(a, matrix, before); });
+    double transform = NanosecondsPerVertex([&]() { TransformPoints(a, matrix, after); });
+    report("point transform, element access: ", transformEager, transform);
+
+    double transformSIMD = NanosecondsPerVertex([&]() { TransformPointsSIMD(a, matrix, after); });
+    std::cout<<"point transform, SSE product:    "<<transformSIMD<<" ns"<<std::endl;
+    return 0;
+}
@@ -0,0 +1,140 @@
+#ifndef BOUNDING_VOLUME_HIERARCHY_H
+#define BOUNDING_VOLUME_HIERARCHY_H
+
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+#include "Frustum.h"
+#include "../Math/Vector.h"
+
+
+// Binary tree of axis aligned boxes over items that have boxes, objects in a scene or clusters of a mesh.
+// Nodes sit in depth-first order, an inner node's left child right after it, so a query skips whole
+// subtrees with one box test and Refit runs backwards over the array
+template <typename ComponentType>
+class BoundingVolumeHierarchy {
+    using Vector3 = Vector<ComponentType, 3>;
+
+    public:
+        struct Box {
+            Vector3 boundsMin, boundsMax;
+        };
+
+        // items are indices into boxes
+        void Build(const std::vector<Box>& boxes, uint32_t leafSize = 4) {
+            nodes.clear();
+            itemIndices.resize(boxes.size());
+            for (uint32_t i = 0; i < boxes.size(); i++) itemIndices[i] = i;
+            if (boxes.empty()) return;
+
+            nodes.reserve(2 * (boxes.size() / std::max(leafSize, 1u)) + 1);
+            BuildNode(boxes, 0, static_cast<uint32_t>(boxes.size()), std::max(leafSize, 1u));
+        }
+
+        // Grows or shrinks every node to fit the items' new boxes, keeping the tree. Cheap, but the tree gets
+        // looser the further items move from where Build saw them
+        void Refit(const std::vector<Box>& boxes) {
+            for (size_t i = nodes.size(); i-- > 0;) {
+                Node& node = nodes[i];
+                if (node.count > 0) {
+                    node.bounds = boxes[itemIndices[node.first]];
+                    for (uint32_t item = node.first + 1; item < node.first + node.count; item++) Grow(node.bounds, boxes[itemIndices[item]]);
+                }
+                else {
+                    node.bounds = nodes[i + 1].bounds;
+                    Grow(node.bounds, nodes[node.first].bounds);
+                }
+            }
+        }
+
+        // Calls visit(item) for every item whose box isn't entirely outside the frustum. Below a node that is
+        // entirely inside a plane that plane isn't tested again, below one inside all of them nothing is
+        template <typename Visit>
+        void Query(const Frustum<ComponentType>& frustum, Visit&& visit) const {
+            if (nodes.empty()) return;
+
+            struct Entry { uint32_t node, planeMask; };
+            Entry stack[maxDepth];
+            int stackSize = 0;
+            stack[stackSize++] = { 0, Frustum<ComponentType>::allPlanes };
+
+            while (stackSize > 0) {
+                Entry entry = stack[--stackSize];
+                const Node& node = nodes[entry.node];
+                if (entry.planeMask && !frustum.IntersectsBox(node.bounds.boundsMin, node.bounds.boundsMax, entry.planeMask)) continue;
+
+                if (node.count > 0) {
+                    for (uint32_t item = node.first; item < node.first + node.count; item++) visit(itemIndices[item]);
+                    continue;
+                }
+                stack[stackSize++] = { node.first, entry.planeMask };
+                stack[stackSize++] = { entry.node + 1, entry.planeMask };
+            }
+        }
+
+        bool IsEmpty() const { return nodes.empty(); }
+        // the box around every item
+        const Box& GetBounds() const { return nodes.front().bounds; }
+        size_t GetNodeCount() const { return nodes.size(); }
+
+    private:
+        // leaves hold itemIndices[first, first + count), inner nodes have count 0 and their right child at first
+        struct Node {
+            Box bounds;
+            uint32_t first = 0, count = 0;
+        };
+
+        // median splits halve the items at every level, far more than 2^64 items would be needed to overflow
+        static constexpr int maxDepth = 64;
+
+        std::vector<Node> nodes;
+        std::vector<uint32_t> itemIndices;
+
+        static void Grow(Box& bounds, const Box& other) {
+            for (int axis = 0; axis < 3; axis++) {
+                bounds.boundsMin[axis] = std::min(bounds.boundsMin[axis], other.boundsMin[axis]);
+                bounds.boundsMax[axis] = std::max(bounds.boundsMax[axis], other.boundsMax[axis]);
+            }
+        }
+
+        // splits the items at the median of their centers along the axis the centers spread most
+        void BuildNode(const std::vector<Box>& boxes, uint32_t first, uint32_t count, uint32_t leafSize) {
+            uint32_t index = static_cast<uint32_t>(nodes.size());
+            nodes.push_back(Node());
+
+            Box bounds = boxes[itemIndices[first]];
+            Vector3 centerMin = (bounds.boundsMin + bounds.boundsMax) * ComponentType(0.5), centerMax = centerMin;
+            for (uint32_t i = first + 1; i < first + count; i++) {
+                const Box& box = boxes[itemIndices[i]];
+                Grow(bounds, box);
+                Vector3 center = (box.boundsMin + box.boundsMax) * ComponentType(0.5);
+                for (int axis = 0; axis < 3; axis++) {
+                    centerMin[axis] = std::min(centerMin[axis], center[axis]);
+                    centerMax[axis] = std::max(centerMax[axis], center[axis]);
+                }
+            }
+            nodes[index].bounds = bounds;
+
+            if (count <= leafSize) {
+                nodes[index].first = first;
+                nodes[index].count = count;
+                return;
+            }
+
+            int axis = 0;
+            for (int i = 1; i < 3; i++) {
+                if (centerMax[i] - centerMin[i] > centerMax[axis] - centerMin[axis]) axis = i;
+            }
+            uint32_t half = count / 2;
+            std::nth_element(itemIndices.begin() + first, itemIndices.begin() + first + half, itemIndices.begin() + first + count,
+            [&boxes, axis](uint32_t a, uint32_t b) {
+                return boxes[a].boundsMin[axis] + boxes[a].boundsMax[axis] < boxes[b].boundsMin[axis] + boxes[b].boundsMax[axis];
+            });
+
+            BuildNode(boxes, first, half, leafSize);
+            nodes[index].first = static_cast<uint32_t>(nodes.size());
+            BuildNode(boxes, first + half, count - half, leafSize);
+        }
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <array>
+#include <math.h>
+#include <stdint.h>
+#include "../Math/Vector.h"
+#include "../Math/Matrix.h"
+
+
+// Six planes as (a, b, c, d), a point is inside a plane when a * x + b * y + c * z + d >= 0.
+// The planes are FrustumClipper's: the camera looks down -z, depth is -w, |x| and |y| stay within depth
+// and depth within [near, far], so a box outside one of them holds only triangles the clipper would reject
+template <typename ComponentType>
+struct Frustum {
+    using Vector3 = Vector<ComponentType, 3>;
+    using Vector4 = Vector<ComponentType, 4>;
+
+    enum Plane { Near, Far, Left, Right, Bottom, Top, PlaneCount };
+    static constexpr uint32_t allPlanes = (1u << PlaneCount) - 1;
+
+    std::array<Vector4, PlaneCount> planes;
+
+    // The planes of matrix's clip volume in the space the matrix maps from: world space for a view projection
+    // matrix, a model's own space for its model view projection matrix
+    static Frustum FromMatrix(const Matrix<ComponentType, 4, 4>& matrix, ComponentType nearPlane, ComponentType farPlane) {
+        Vector4 rows[4];
+        for (int i = 0; i < 4; i++) rows[i] = Vector4(matrix(i, 0), matrix(i, 1), matrix(i, 2), matrix(i, 3));
+
+        Frustum frustum;
+        frustum.planes[Near] = -rows[3] - Vector4(0, 0, 0, nearPlane);
+        frustum.planes[Far] = rows[3] + Vector4(0, 0, 0, farPlane);
+        frustum.planes[Left] = -rows[3] - rows[0];
+        frustum.planes[Right] = rows[0] - rows[3];
+        frustum.planes[Bottom] = -rows[3] - rows[1];
+        frustum.planes[Top] = rows[1] - rows[3];
+
+        // unit normals, so a plane gives true distances
+        for (Vector4& plane : frustum.planes) {
+            ComponentType length = sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+            if (length > ComponentType(0)) plane = plane / length;
+        }
+        return frustum;
+    }
+
+    // The point the four side planes meet at, the camera's position in the space the matrix maps from:
+    // the one point with clip x, y and w all 0
+    static Vector3 GetApex(const Matrix<ComponentType, 4, 4>& matrix) {
+        const int rows[3] = { 0, 1, 3 };
+        ComponentType a[3][3], b[3];
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) a[i][j] = matrix(rows[i], j);
+            b[i] = -matrix(rows[i], 3);
+        }
+
+        // Cramer's rule, the matrix is invertible for any real camera
+        auto determinant = [](const ComponentType m[3][3]) {
+            return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+                 + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+        };
+        ComponentType denominator = determinant(a);
+        Vector3 apex;
+        if (denominator == ComponentType(0)) return apex;
+        for (int column = 0; column < 3; column++) {
+            ComponentType replaced[3][3];
+            for (int i = 0; i < 3; i++) {
+                for (int j = 0; j < 3; j++) replaced[i][j] = j == column ? b[i] : a[i][j];
+            }
+            apex[column] = determinant(replaced) / denominator;
+        }
+        return apex;
+    }
+
+    // False if the box is entirely outside one of the planes in planeMask. Planes the box is entirely inside
+    // are cleared from planeMask, so anything contained in the box can skip them
+    bool IntersectsBox(const Vector3& boundsMin, const Vector3& boundsMax, uint32_t& planeMask) const {
+        for (int i = 0; i < PlaneCount; i++) {
+            if (!(planeMask & (1u << i))) continue;
+            const Vector4& plane = planes[i];
+
+            // the corners furthest along and against the normal
+            ComponentType outermost = plane[3], innermost = plane[3];
+            for (int axis = 0; axis < 3; axis++) {
+                bool positive = plane[axis] >= ComponentType(0);
+                outermost += plane[axis] * (positive ? boundsMax[axis] : boundsMin[axis]);
+                innermost += plane[axis] * (positive ? boundsMin[axis] : boundsMax[axis]);
+            }
+            if (outermost < ComponentType(0)) return false;
+            if (innermost >= ComponentType(0)) planeMask &= ~(1u << i);
+        }
+        return true;
+    }
+
+    bool IntersectsBox(const Vector3& boundsMin, const Vector3& boundsMax) const {
+        uint32_t planeMask = allPlanes;
+        return IntersectsBox(boundsMin, boundsMax, planeMask);
+    }
+
+    // the planes have unit normals, so this is one dot product per plane
+    bool IntersectsSphere(const Vector3& center, ComponentType radius) const {
+        for (const Vector4& plane : planes) {
+            if (plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3] < -radius) return false;
+        }
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <stdint.h>
+#include <string.h>
+#include "Polygon.h"
+#include "Vertex.h"
+#include "VertexStreams.h"
+
+
+// Indexed triangle mesh: every distinct vertex is stored once and triangles are 3 indices into vertices.
+// A smooth closed mesh takes about a third of the memory of the same triangles as Polygon3D,
+// and a vertex shared by several triangles only has to be transformed once
+template <typename ComponentType>
+struct Mesh {
+    using VertexType = Vertex3<ComponentType>;
+    using Triangle = Polygon3D<ComponentType, 3>;
+
+    std::vector<VertexType> vertices;
+    std::vector<uint32_t> indices;          // 3 per triangle
+    // Per vertex, the first vertex with the same position. Vertices split only by their normal or texture
+    // coordinates (hard edges, UV seams) share it, so the position is transformed once
+    std::vector<uint32_t> positionIndices;
+    // optional structure of arrays copy of vertices for the vectorized passes, costs as much memory again
+    VertexStreams<ComponentType> streams;
+
+    size_t GetTriangleCount() const { return indices.size() / 3; }
+
+    const VertexType& GetVertex(size_t triangle, int corner) const { return vertices[indices[triangle * 3 + corner]]; }
+
+    Triangle GetTriangle(size_t triangle) const {
+        return Triangle(std::array<VertexType, 3>{ GetVertex(triangle, 0), GetVertex(triangle, 1), GetVertex(triangle, 2) });
+    }
+
+    bool HasVertexStreams() const { return !vertices.empty() && streams.size() == vertices.size(); }
+    // needed again whenever vertices change
+    void BuildVertexStreams() { streams.Assign(vertices); }
+
+    // fills positionIndices, needed again whenever vertices change
+    void IndexSharedPositions() {
+        std::unordered_map<PositionKey, uint32_t, KeyHash<PositionKey>> lookup;
+        lookup.reserve(vertices.size());
+        positionIndices.resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            positionIndices[i] = lookup.emplace(PositionKey(vertices[i]), static_cast<uint32_t>(i)).first->second;
+        }
+    }
+
+    std::vector<Triangle> ToTriangles() const {
+        std::vector<Triangle> triangles;
+        triangles.reserve(GetTriangleCount());
+        for (size_t i = 0; i < GetTriangleCount(); i++) triangles.push_back(GetTriangle(i));
+        return triangles;
+    }
+
+    // Corners with exactly the same position, normal and texture coordinates become one vertex
+    static Mesh FromTriangles(const std::vector<Triangle>& triangles) {
+        Mesh mesh;
+        mesh.indices.reserve(triangles.size() * 3);
+        std::unordered_map<VertexKey, uint32_t, KeyHash<VertexKey>> lookup;
+        lookup.reserve(triangles.size() * 3);
+
+        for (const Triangle& triangle : triangles) {
+            for (const VertexType& vertex : triangle.vertices) {
+                auto inserted = lookup.emplace(VertexKey(vertex), static_cast<uint32_t>(mesh.vertices.size()));
+                if (inserted.second) mesh.vertices.push_back(vertex);
+                mesh.indices.push_back(inserted.first->second);
+            }
+        }
+        mesh.IndexSharedPositions();
+        return mesh;
+    }
+
+    private:
+        // Components of a vertex for exact comparison. + 0 turns -0 into 0, they compare equal so they have to hash the same
+        template <int ComponentCount>
+        struct ComponentKey {
+            ComponentType components[ComponentCount];
+
+            bool operator==(const ComponentKey& other) const {
+                for (int i = 0; i < ComponentCount; i++) {
+                    if (components[i] != other.components[i]) return false;
+                }
+                return true;
+            }
+        };
+
+        struct PositionKey : ComponentKey<3> {
+            explicit PositionKey(const VertexType& vertex) {
+                for (int i = 0; i < 3; i++) this->components[i] = vertex.position[i] + ComponentType(0);
+            }
+        };
+
+        struct VertexKey : ComponentKey<8> {
+            explicit VertexKey(const VertexType& vertex) {
+                for (int i = 0; i < 3; i++) this->components[i] = vertex.position[i] + ComponentType(0);
+                for (int i = 0; i < 3; i++) this->components[3 + i] = vertex.normal[i] + ComponentType(0);
+                for (int i = 0; i < 2; i++) this->components[6 + i] = vertex.textureCoordinates[i] + ComponentType(0);
+            }
+        };
+
+        template <typename Key>
+        struct KeyHash {
+            size_t operator()(const Key& key) const {
+                uint64_t hash = 0xcbf29ce484222325ull;
+                for (ComponentType component : key.components) {
+                    uint64_t bits = 0;
+                    memcpy(&bits, &component, sizeof(component) < sizeof(bits) ? sizeof(component) : sizeof(bits));
+                    hash = (hash ^ bits) * 0x100000001b3ull;
+                }
+                return static_cast<size_t>(hash);
+            }
+        };
+};
+
+
+#endif
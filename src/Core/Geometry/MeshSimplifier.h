@@ -0,0 +1,261 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <vector>
+#include <array>
+#include <queue>
+#include <algorithm>
+#include <unordered_map>
+#include <math.h>
+#include <stdint.h>
+#include "Mesh.h"
+#include "Polygon.h"
+#include "../Math/Vector.h"
+
+
+namespace MeshSimplification {
+
+    using Point = std::array<double, 3>;
+
+    // Sum of squared distances to a set of planes, the symmetric 4x4 matrix of Garland and Heckbert's
+    // quadric error metric stored as its upper triangle: xx xy xz xw yy yz yw zz zw ww
+    struct Quadric {
+        double terms[10] = {};
+
+        void AddPlane(double nx, double ny, double nz, double d, double weight) {
+            const double plane[4] = { nx, ny, nz, d };
+            int term = 0;
+            for (int i = 0; i < 4; i++) {
+                for (int j = i; j < 4; j++) terms[term++] += weight * plane[i] * plane[j];
+            }
+        }
+
+        Quadric& operator+=(const Quadric& other) {
+            for (int i = 0; i < 10; i++) terms[i] += other.terms[i];
+            return *this;
+        }
+
+        double Error(const Point& p) const {
+            const double* q = terms;
+            return q[0] * p[0] * p[0] + 2 * q[1] * p[0] * p[1] + 2 * q[2] * p[0] * p[2] + 2 * q[3] * p[0]
+                 + q[4] * p[1] * p[1] + 2 * q[5] * p[1] * p[2] + 2 * q[6] * p[1]
+                 + q[7] * p[2] * p[2] + 2 * q[8] * p[2] + q[9];
+        }
+
+        // The point of least error, false when the planes don't pin one down (flat or straight neighbourhoods)
+        bool Minimum(Point& p) const {
+            const double* q = terms;
+            const double a[3][3] = { { q[0], q[1], q[2] }, { q[1], q[4], q[5] }, { q[2], q[5], q[7] } };
+            const double b[3] = { -q[3], -q[6], -q[8] };
+
+            auto determinant = [](const double m[3][3]) {
+                return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+                     + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+            };
+            double denominator = determinant(a);
+            double scale = fabs(q[0]) + fabs(q[4]) + fabs(q[7]);
+            if (fabs(denominator) <= 1e-12 * scale * scale * scale) return false;
+
+            for (int column = 0; column < 3; column++) {
+                double replaced[3][3];
+                for (int i = 0; i < 3; i++) {
+                    for (int j = 0; j < 3; j++) replaced[i][j] = j == column ? b[i] : a[i][j];
+                }
+                p[column] = determinant(replaced) / denominator;
+            }
+            return true;
+        }
+    };
+
+    inline Point Cross(const Point& a, const Point& b) {
+        return { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+    }
+
+    inline Point Subtract(const Point& a, const Point& b) {
+        return { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+    }
+
+    inline double Dot(const Point& a, const Point& b) {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    // open edges are held in place by a plane through them at right angles to their face, this much stiffer
+    // than the faces themselves so outlines survive
+    constexpr double boundaryWeight = 100.0;
+}
+
+
+// Collapses edges, cheapest under the quadric error metric first, until at most targetTriangles are left or
+// no collapse is possible without flipping a face. Vertices that only differ in normal or texture coordinates
+// move together, and every corner keeps its own normal and texture coordinates
+template <typename ComponentType>
+Mesh<ComponentType> SimplifyMesh(const Mesh<ComponentType>& mesh, size_t targetTriangles) {
+    using namespace MeshSimplification;
+    using VertexType = Vertex3<ComponentType>;
+
+    const size_t triangleCount = mesh.GetTriangleCount();
+    const size_t vertexCount = mesh.vertices.size();
+    const bool sharedPositions = mesh.positionIndices.size() == vertexCount;
+
+    // corners refer to positions, a position is the first vertex that has it
+    std::vector<uint32_t> corners(triangleCount * 3);
+    for (size_t i = 0; i < corners.size(); i++) corners[i] = sharedPositions ? mesh.positionIndices[mesh.indices[i]] : mesh.indices[i];
+
+    std::vector<Point> positions(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        for (int axis = 0; axis < 3; axis++) positions[v][axis] = mesh.vertices[v].position[axis];
+    }
+
+    std::vector<Quadric> quadrics(vertexCount);
+    std::vector<std::vector<uint32_t>> positionTriangles(vertexCount);
+    std::unordered_map<uint64_t, uint32_t> edgeUses;
+    edgeUses.reserve(triangleCount * 3);
+    auto edgeKey = [](uint32_t a, uint32_t b) { return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a; };
+
+    // every face's plane, weighted by its area so big faces keep their shape
+    for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+        const uint32_t* corner = &corners[triangle * 3];
+        Point normal = Cross(Subtract(positions[corner[1]], positions[corner[0]]), Subtract(positions[corner[2]], positions[corner[0]]));
+        double doubleArea = sqrt(Dot(normal, normal));
+        for (int k = 0; k < 3; k++) {
+            positionTriangles[corner[k]].push_back(static_cast<uint32_t>(triangle));
+            edgeUses[edgeKey(corner[k], corner[(k + 1) % 3])]++;
+        }
+        if (doubleArea <= 0.0) continue;
+
+        for (double& component : normal) component /= doubleArea;
+        for (int k = 0; k < 3; k++) quadrics[corner[k]].AddPlane(normal[0], normal[1], normal[2], -Dot(normal, positions[corner[0]]), doubleArea * 0.5);
+    }
+
+    for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+        const uint32_t* corner = &corners[triangle * 3];
+        Point faceNormal = Cross(Subtract(positions[corner[1]], positions[corner[0]]), Subtract(positions[corner[2]], positions[corner[0]]));
+        for (int k = 0; k < 3; k++) {
+            uint32_t a = corner[k], b = corner[(k + 1) % 3];
+            if (edgeUses[edgeKey(a, b)] != 1) continue;
+
+            Point edge = Subtract(positions[b], positions[a]);
+            Point normal = Cross(edge, faceNormal);
+            double length = sqrt(Dot(normal, normal));
+            if (length <= 0.0) continue;
+            for (double& component : normal) component /= length;
+
+            double d = -Dot(normal, positions[a]);
+            quadrics[a].AddPlane(normal[0], normal[1], normal[2], d, boundaryWeight * Dot(edge, edge));
+            quadrics[b].AddPlane(normal[0], normal[1], normal[2], d, boundaryWeight * Dot(edge, edge));
+        }
+    }
+
+    // A collapse of b into a, valid while neither position changed since it was costed
+    struct Candidate {
+        double cost;
+        uint32_t a, b, versionA, versionB;
+        Point target;
+        bool operator>(const Candidate& other) const { return cost > other.cost; }
+    };
+    std::vector<uint32_t> versions(vertexCount, 0);
+    std::vector<uint8_t> positionRemoved(vertexCount, 0), triangleRemoved(triangleCount, 0);
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+
+    // the optimum when there is one, else whichever of the ends and the middle costs least
+    auto pushCandidate = [&](uint32_t a, uint32_t b) {
+        Quadric quadric = quadrics[a];
+        quadric += quadrics[b];
+
+        Point options[4] = { positions[a], positions[b],
+                             { (positions[a][0] + positions[b][0]) * 0.5, (positions[a][1] + positions[b][1]) * 0.5, (positions[a][2] + positions[b][2]) * 0.5 } };
+        int optionCount = quadric.Minimum(options[3]) ? 4 : 3;
+
+        Candidate candidate = { quadric.Error(options[0]), a, b, versions[a], versions[b], options[0] };
+        for (int i = 1; i < optionCount; i++) {
+            double cost = quadric.Error(options[i]);
+            if (cost < candidate.cost) {
+                candidate.cost = cost;
+                candidate.target = options[i];
+            }
+        }
+        candidates.push(candidate);
+    };
+
+    for (const auto& edge : edgeUses) pushCandidate(static_cast<uint32_t>(edge.first >> 32), static_cast<uint32_t>(edge.first & 0xFFFFFFFFu));
+
+    // moving position from its place to target must not turn any of its faces over
+    auto flipsFaces = [&](uint32_t position, uint32_t other, const Point& target) {
+        for (uint32_t triangle : positionTriangles[position]) {
+            if (triangleRemoved[triangle]) continue;
+            const uint32_t* corner = &corners[triangle * 3];
+            if (corner[0] == other || corner[1] == other || corner[2] == other) continue;
+
+            Point before[3], after[3];
+            for (int k = 0; k < 3; k++) {
+                before[k] = positions[corner[k]];
+                after[k] = corner[k] == position ? target : before[k];
+            }
+            Point normalBefore = Cross(Subtract(before[1], before[0]), Subtract(before[2], before[0]));
+            Point normalAfter = Cross(Subtract(after[1], after[0]), Subtract(after[2], after[0]));
+            if (Dot(normalBefore, normalAfter) <= 0.0) return true;
+        }
+        return false;
+    };
+
+    size_t remaining = triangleCount;
+    std::vector<uint32_t> neighbours;
+    while (remaining > targetTriangles && !candidates.empty()) {
+        Candidate candidate = candidates.top();
+        candidates.pop();
+        const uint32_t a = candidate.a, b = candidate.b;
+        if (positionRemoved[a] || positionRemoved[b] || versions[a] != candidate.versionA || versions[b] != candidate.versionB) continue;
+        if (flipsFaces(a, b, candidate.target) || flipsFaces(b, a, candidate.target)) continue;
+
+        positions[a] = candidate.target;
+        quadrics[a] += quadrics[b];
+        positionRemoved[b] = 1;
+        versions[a]++;
+
+        // faces on the edge disappear, b's other faces move over to a
+        for (uint32_t triangle : positionTriangles[b]) {
+            if (triangleRemoved[triangle]) continue;
+            uint32_t* corner = &corners[triangle * 3];
+            if (corner[0] == a || corner[1] == a || corner[2] == a) {
+                triangleRemoved[triangle] = 1;
+                remaining--;
+                continue;
+            }
+            for (int k = 0; k < 3; k++) {
+                if (corner[k] == b) corner[k] = a;
+            }
+            positionTriangles[a].push_back(triangle);
+        }
+        positionTriangles[b].clear();
+
+        std::vector<uint32_t>& aTriangles = positionTriangles[a];
+        aTriangles.erase(std::remove_if(aTriangles.begin(), aTriangles.end(), [&](uint32_t triangle) { return triangleRemoved[triangle]; }), aTriangles.end());
+
+        // every edge at a costs something else now
+        neighbours.clear();
+        for (uint32_t triangle : aTriangles) {
+            for (int k = 0; k < 3; k++) {
+                uint32_t neighbour = corners[triangle * 3 + k];
+                if (neighbour != a && std::find(neighbours.begin(), neighbours.end(), neighbour) == neighbours.end()) neighbours.push_back(neighbour);
+            }
+        }
+        for (uint32_t neighbour : neighbours) pushCandidate(a, neighbour);
+    }
+
+    std::vector<Polygon3D<ComponentType, 3>> triangles;
+    triangles.reserve(remaining);
+    for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+        if (triangleRemoved[triangle]) continue;
+        std::array<VertexType, 3> vertices;
+        for (int k = 0; k < 3; k++) {
+            vertices[k] = mesh.vertices[mesh.indices[triangle * 3 + k]];
+            const Point& position = positions[corners[triangle * 3 + k]];
+            vertices[k].position = Vector<ComponentType, 3>(static_cast<ComponentType>(position[0]), static_cast<ComponentType>(position[1]),
+                                                            static_cast<ComponentType>(position[2]));
+        }
+        triangles.push_back(Polygon3D<ComponentType, 3>(vertices));
+    }
+    return Mesh<ComponentType>::FromTriangles(triangles);
+}
+
+#endif
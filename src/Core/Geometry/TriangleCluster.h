@@ -0,0 +1,218 @@
+#ifndef TRIANGLE_CLUSTER_H
+#define TRIANGLE_CLUSTER_H
+
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <stdint.h>
+#include "Mesh.h"
+#include "../Math/Vector.h"
+
+
+// A run of consecutive triangles of a mesh with its object space bounds and normal cone,
+// lets whole groups be culled without touching their triangles
+template <typename ComponentType>
+struct TriangleCluster {
+    using Vector3 = Vector<ComponentType, 3>;
+
+    size_t first = 0, count = 0;
+    Vector3 boundsMin, boundsMax;
+    Vector3 sphereCenter;
+    ComponentType sphereRadius = 0;
+
+    // Every face normal is within coneCutoff (the sine of the angle) of 90 degrees from coneAxis, and coneApex
+    // is behind every triangle's plane. coneCutoff above 1 when the normals spread too far for a cone
+    Vector3 coneAxis, coneApex;
+    ComponentType coneCutoff = 2;
+
+    // True when every triangle faces away from eye, a point in the same space as the cluster: seen from eye
+    // the apex lies within the cone, so each triangle's normal points less than 90 degrees from the line of sight
+    bool IsBackFacing(const Vector3& eye) const {
+        Vector3 toApex = coneApex - eye;
+        return toApex * coneAxis >= coneCutoff * toApex.Length();
+    }
+};
+
+namespace TriangleClusters {
+
+    // counterclockwise corners face the normal, zero for degenerate triangles
+    template <typename ComponentType>
+    Vector<ComponentType, 3> GetFaceNormal(const Mesh<ComponentType>& mesh, size_t triangle) {
+        const Vector<ComponentType, 3>& a = mesh.GetVertex(triangle, 0).position;
+        Vector<ComponentType, 3> normal = (mesh.GetVertex(triangle, 1).position - a) % (mesh.GetVertex(triangle, 2).position - a);
+        ComponentType length = normal.Length();
+        return length > ComponentType(0) ? Vector<ComponentType, 3>(normal / length) : Vector<ComponentType, 3>();
+    }
+
+    // box, sphere and cone of the triangles cluster.first to cluster.first + cluster.count
+    template <typename ComponentType>
+    void ComputeBounds(const Mesh<ComponentType>& mesh, TriangleCluster<ComponentType>& cluster) {
+        using Vector3 = Vector<ComponentType, 3>;
+
+        cluster.boundsMin = mesh.GetVertex(cluster.first, 0).position;
+        cluster.boundsMax = mesh.GetVertex(cluster.first, 0).position;
+        for (size_t i = cluster.first * 3; i < (cluster.first + cluster.count) * 3; i++) {
+            const Vector3& position = mesh.vertices[mesh.indices[i]].position;
+            for (int axis = 0; axis < 3; axis++) {
+                cluster.boundsMin[axis] = std::min(cluster.boundsMin[axis], position[axis]);
+                cluster.boundsMax[axis] = std::max(cluster.boundsMax[axis], position[axis]);
+            }
+        }
+
+        cluster.sphereCenter = (cluster.boundsMin + cluster.boundsMax) * ComponentType(0.5);
+        cluster.sphereRadius = 0;
+        for (size_t i = cluster.first * 3; i < (cluster.first + cluster.count) * 3; i++) {
+            Vector3 offset = mesh.vertices[mesh.indices[i]].position - cluster.sphereCenter;
+            cluster.sphereRadius = std::max(cluster.sphereRadius, static_cast<ComponentType>(offset.Length()));
+        }
+
+        // the axis is the average normal, the cone has to reach the normal furthest from it
+        Vector3 normalSum;
+        for (size_t triangle = cluster.first; triangle < cluster.first + cluster.count; triangle++) normalSum += GetFaceNormal(mesh, triangle);
+        ComponentType sumLength = normalSum.Length();
+        cluster.coneAxis = sumLength > ComponentType(0) ? Vector3(normalSum / sumLength) : Vector3();
+        cluster.coneCutoff = 2;
+        if (sumLength <= ComponentType(0)) return;
+
+        ComponentType minimumDot = 1;
+        for (size_t triangle = cluster.first; triangle < cluster.first + cluster.count; triangle++) {
+            Vector3 normal = GetFaceNormal(mesh, triangle);
+            if (normal.SquaredComponentSum() == ComponentType(0)) continue;
+            minimumDot = std::min(minimumDot, static_cast<ComponentType>(normal * cluster.coneAxis));
+        }
+        // at 90 degrees or more some triangle faces every eye position
+        if (minimumDot <= ComponentType(0)) return;
+        cluster.coneCutoff = sqrt(ComponentType(1) - minimumDot * minimumDot);
+
+        // back along the axis from the center until behind every triangle's plane
+        ComponentType apexDistance = 0;
+        for (size_t triangle = cluster.first; triangle < cluster.first + cluster.count; triangle++) {
+            Vector3 normal = GetFaceNormal(mesh, triangle);
+            if (normal.SquaredComponentSum() == ComponentType(0)) continue;
+            ComponentType centerDistance = (cluster.sphereCenter - mesh.GetVertex(triangle, 0).position) * normal;
+            apexDistance = std::max(apexDistance, static_cast<ComponentType>(centerDistance / (normal * cluster.coneAxis)));
+        }
+        cluster.coneApex = cluster.sphereCenter - cluster.coneAxis * apexDistance;
+    }
+}
+
+// Model files list faces roughly in surface order, so consecutive runs are already spatially compact
+template <typename ComponentType>
+std::vector<TriangleCluster<ComponentType>> BuildTriangleClusters(const Mesh<ComponentType>& mesh, size_t clusterSize = 64) {
+    const size_t triangleCount = mesh.GetTriangleCount();
+    std::vector<TriangleCluster<ComponentType>> clusters;
+    clusters.reserve((triangleCount + clusterSize - 1) / clusterSize);
+
+    for (size_t first = 0; first < triangleCount; first += clusterSize) {
+        TriangleCluster<ComponentType> cluster;
+        cluster.first = first;
+        cluster.count = std::min(clusterSize, triangleCount - first);
+        TriangleClusters::ComputeBounds(mesh, cluster);
+        clusters.push_back(cluster);
+    }
+    return clusters;
+}
+
+// Regroups the mesh's triangles into meshlets of at most maxTriangles and reorders mesh.indices so each is a
+// consecutive run. A meshlet grows from a seed triangle over shared corners, preferring triangles that share
+// an edge with it and face the way it does, so it stays compact and its normal cone narrow enough for
+// IsBackFacing to drop whole meshlets. Vertices don't move, only the triangle order changes
+template <typename ComponentType>
+std::vector<TriangleCluster<ComponentType>> BuildMeshlets(Mesh<ComponentType>& mesh, size_t maxTriangles = 64) {
+    using Vector3 = Vector<ComponentType, 3>;
+
+    const size_t triangleCount = mesh.GetTriangleCount();
+    const size_t vertexCount = mesh.vertices.size();
+    const bool sharedPositions = mesh.positionIndices.size() == vertexCount;
+    auto corner = [&](size_t triangle, int k) -> uint32_t {
+        uint32_t vertex = mesh.indices[triangle * 3 + k];
+        return sharedPositions ? mesh.positionIndices[vertex] : vertex;
+    };
+
+    std::vector<Vector3> faceNormals(triangleCount);
+    for (size_t triangle = 0; triangle < triangleCount; triangle++) faceNormals[triangle] = TriangleClusters::GetFaceNormal(mesh, triangle);
+
+    // triangles around each position, vertexTriangles[vertexStart[v], vertexStart[v + 1])
+    std::vector<uint32_t> vertexStart(vertexCount + 1, 0), vertexTriangles(triangleCount * 3);
+    for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+        for (int k = 0; k < 3; k++) vertexStart[corner(triangle, k) + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++) vertexStart[v + 1] += vertexStart[v];
+    std::vector<uint32_t> filled(vertexStart.begin(), vertexStart.end() - 1);
+    for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+        for (int k = 0; k < 3; k++) vertexTriangles[filled[corner(triangle, k)]++] = static_cast<uint32_t>(triangle);
+    }
+
+    std::vector<uint32_t> order;            // triangles in meshlet order
+    std::vector<uint8_t> assigned(triangleCount, 0);
+    std::vector<uint32_t> candidateOf(triangleCount, UINT32_MAX), vertexOf(vertexCount, UINT32_MAX);    // last meshlet that saw it
+    std::vector<uint32_t> candidates;
+    order.reserve(triangleCount);
+    size_t nextSeed = 0;
+
+    std::vector<TriangleCluster<ComponentType>> clusters;
+    for (uint32_t meshlet = 0; order.size() < triangleCount; meshlet++) {
+        TriangleCluster<ComponentType> cluster;
+        cluster.first = order.size();
+        candidates.clear();
+        Vector3 normalSum;
+
+        while (order.size() - cluster.first < maxTriangles && order.size() < triangleCount) {
+            Vector3 axis = normalSum.SquaredComponentSum() > ComponentType(0) ? normalSum.Unit() : Vector3();
+
+            // two corners already in the meshlet outweigh any normal, among equals the closer normal wins
+            uint32_t best = UINT32_MAX;
+            ComponentType bestScore = 0;
+            size_t kept = 0;
+            for (uint32_t candidate : candidates) {
+                if (assigned[candidate]) continue;
+                candidates[kept++] = candidate;
+
+                int sharedCorners = 0;
+                for (int k = 0; k < 3; k++) sharedCorners += vertexOf[corner(candidate, k)] == meshlet;
+                ComponentType score = ComponentType(sharedCorners) * 2 + faceNormals[candidate] * axis;
+                if (best == UINT32_MAX || score > bestScore) {
+                    best = candidate;
+                    bestScore = score;
+                }
+            }
+            candidates.resize(kept);
+
+            // nothing connected is left: stop, unless the meshlet would be too small to be worth a cone
+            if (best == UINT32_MAX) {
+                if (order.size() - cluster.first >= maxTriangles / 4) break;
+                while (assigned[nextSeed]) nextSeed++;
+                best = static_cast<uint32_t>(nextSeed);
+            }
+
+            assigned[best] = 1;
+            order.push_back(best);
+            normalSum += faceNormals[best];
+            for (int k = 0; k < 3; k++) {
+                uint32_t vertex = corner(best, k);
+                vertexOf[vertex] = meshlet;
+                for (uint32_t i = vertexStart[vertex]; i < vertexStart[vertex + 1]; i++) {
+                    uint32_t neighbour = vertexTriangles[i];
+                    if (assigned[neighbour] || candidateOf[neighbour] == meshlet) continue;
+                    candidateOf[neighbour] = meshlet;
+                    candidates.push_back(neighbour);
+                }
+            }
+        }
+
+        cluster.count = order.size() - cluster.first;
+        clusters.push_back(cluster);
+    }
+
+    std::vector<uint32_t> indices(mesh.indices.size());
+    for (size_t i = 0; i < triangleCount; i++) {
+        for (int k = 0; k < 3; k++) indices[i * 3 + k] = mesh.indices[order[i] * 3 + k];
+    }
+    mesh.indices = std::move(indices);
+
+    for (TriangleCluster<ComponentType>& cluster : clusters) TriangleClusters::ComputeBounds(mesh, cluster);
+    return clusters;
+}
+
+
+#endif
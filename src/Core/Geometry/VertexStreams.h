@@ -0,0 +1,40 @@
+#ifndef VERTEX_STREAMS_H
+#define VERTEX_STREAMS_H
+
+#include <vector>
+#include <stddef.h>
+#include "Vertex.h"
+#include "../Utilities/AlignedAllocator.h"
+
+
+// Structure of arrays copy of a vertex array, one cache line aligned stream per component.
+// A pass that only needs positions reads x, y and z and never pulls normals or texture coordinates
+// through the cache, and 8 consecutive vertices fill one AVX register per component
+template <typename ComponentType>
+struct VertexStreams {
+    using Stream = std::vector<ComponentType, AlignedAllocator<ComponentType, 64>>;
+
+    Stream x, y, z;
+    Stream nx, ny, nz;
+    Stream u, v;
+
+    size_t size() const { return x.size(); }
+
+    void Assign(const std::vector<Vertex3<ComponentType>>& vertices) {
+        for (Stream* stream : { &x, &y, &z, &nx, &ny, &nz, &u, &v }) stream->resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            const Vertex3<ComponentType>& vertex = vertices[i];
+            x[i] = vertex.position[0];
+            y[i] = vertex.position[1];
+            z[i] = vertex.position[2];
+            nx[i] = vertex.normal[0];
+            ny[i] = vertex.normal[1];
+            nz[i] = vertex.normal[2];
+            u[i] = vertex.textureCoordinates[0];
+            v[i] = vertex.textureCoordinates[1];
+        }
+    }
+};
+
+
+#endif
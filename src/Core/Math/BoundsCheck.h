@@ -0,0 +1,19 @@
+#ifndef BOUNDS_CHECK_H
+#define BOUNDS_CHECK_H
+
+#include <stdexcept>
+
+
+// Vector and Matrix element access only checks indices in debug builds, release builds index directly.
+// Define MATH_BOUNDS_CHECKS to keep the checks in a release build
+#if !defined(NDEBUG) && !defined(MATH_BOUNDS_CHECKS)
+#define MATH_BOUNDS_CHECKS
+#endif
+
+#ifdef MATH_BOUNDS_CHECKS
+#define MATH_CHECK_INDEX(condition, message) if (!(condition)) throw std::out_of_range(message)
+#else
+#define MATH_CHECK_INDEX(condition, message)
+#endif
+
+#endif
@@ -4,14 +4,16 @@
 #include <iostream>
 #include <array>
 #include <initializer_list>
+#include "BoundsCheck.h"
 
 template <typename ElementType, size_t Rows, size_t Columns>
 struct Matrix {
     using MatrixNxM = Matrix<ElementType, Rows, Columns>;
-    std::array<ElementType, Rows*Columns> elements;
+    // rows of 16 bytes (4x4 float) are aligned to 16 so MatrixSIMD.h can load them directly
+    alignas(sizeof(ElementType) * Columns == 16 ? 16 : alignof(ElementType)) std::array<ElementType, Rows*Columns> elements;
 
     // Matrix addition
-    MatrixNxM operator+(const MatrixNxM &other) const {
+    constexpr MatrixNxM operator+(const MatrixNxM &other) const {
         static_assert(Rows > 0 && Columns > 0, "Matrix addition is not defined for zero-dimensional matrices.");
         MatrixNxM temp;
         for(int i=0; i < Rows * Columns; i++) temp.elements[i] = elements[i] + other.elements[i];
@@ -19,13 +21,13 @@ struct Matrix {
     }
 
     // Addition with assignment
-    void operator+=(const MatrixNxM &other) {
+    constexpr void operator+=(const MatrixNxM &other) {
         static_assert(Rows > 0 && Columns > 0, "Matrix addition is not defined for zero-dimensional matrices.");
         for(int i=0; i < Rows * Columns; i++) elements[i] += other.elements[i];
     }
 
     // Matrix subtraction
-    MatrixNxM operator-(const MatrixNxM &other) const {
+    constexpr MatrixNxM operator-(const MatrixNxM &other) const {
         static_assert(Rows > 0 && Columns > 0, "Matrix subtraction is not defined for zero-dimensional matrices.");
         MatrixNxM temp;
         for(int i=0; i < Rows * Columns; i++) temp.elements[i] = elements[i] - other.elements[i];
@@ -33,19 +35,19 @@ struct Matrix {
     }
 
     // Subtraction with assignment
-    void operator-=(const MatrixNxM &other) {
+    constexpr void operator-=(const MatrixNxM &other) {
         static_assert(Rows > 0 && Columns > 0, "Matrix subtraction is not defined for zero-dimensional matrices.");
         for(int i=0; i < Rows * Columns; i++) elements[i] -= other.elements[i];
     }
 
     // Matrix negation
-    void operator-() {
+    constexpr void operator-() {
         static_assert(Rows > 0 && Columns > 0, "Matrix negation is not defined for zero-dimensional matrices.");
         for(int i=0; i < Rows * Columns; i++) elements[i] = -elements[i];
     }
 
     // Matrix-scalar addition
-    template<typename scalarType> MatrixNxM operator+(const scalarType &scalar) const {
+    template<typename scalarType> constexpr MatrixNxM operator+(const scalarType &scalar) const {
         static_assert(Rows > 0 && Columns > 0, "Matrix-scalar addition is not defined for zero-dimensional matrices.");
         MatrixNxM temp = *this;
         for(int i=0; i < Rows * Columns; i++) temp.elements[i] += scalar;
@@ -53,7 +55,7 @@ struct Matrix {
     }
 
     // Matrix-scalar subtraction
-    template<typename scalarType> MatrixNxM operator-(const scalarType &scalar) const {
+    template<typename scalarType> constexpr MatrixNxM operator-(const scalarType &scalar) const {
         static_assert(Rows > 0 && Columns > 0, "Matrix-scalar subtraction is not defined for zero-dimensional matrices.");
         MatrixNxM temp = *this;
         for(int i=0; i < Rows * Columns; i++) temp.elements[i] -= scalar;
@@ -61,7 +63,7 @@ struct Matrix {
     }
 
     // Matrix-scalar multiplication
-    template<typename scalarType> MatrixNxM operator*(const scalarType &scalar) const {
+    template<typename scalarType> constexpr MatrixNxM operator*(const scalarType &scalar) const {
         static_assert(Rows > 0 && Columns > 0, "Matrix-scalar multiplication is not defined for zero-dimensional matrices.");
         MatrixNxM temp = *this;
         for(int i=0; i < Rows * Columns; i++) temp.elements[i] *= scalar;
@@ -69,13 +71,13 @@ struct Matrix {
     }
 
     // Matrix-scalar multiplication with assignment
-    template<typename scalarType> void operator*=(const scalarType &scalar) {
+    template<typename scalarType> constexpr void operator*=(const scalarType &scalar) {
         static_assert(Rows > 0 && Columns > 0, "Matrix-scalar multiplication is not defined for zero-dimensional matrices.");
         for(int i=0; i < Rows * Columns; i++) elements[i] *= scalar;
     }
 
     // Matrix-scalar division
-    template<typename scalarType> MatrixNxM operator/(const scalarType &scalar) const {
+    template<typename scalarType> constexpr MatrixNxM operator/(const scalarType &scalar) const {
         static_assert(Rows > 0 && Columns > 0, "Matrix-scalar division is not defined for zero-dimensional matrices.");
         MatrixNxM temp = *this;
         for(int i=0; i < Rows * Columns; i++) temp.elements[i] /= scalar;
@@ -83,31 +85,27 @@ struct Matrix {
     }
 
     // Matrix-scalar division with assignment
-    template<typename scalarType> void operator/=(const scalarType &scalar) {
+    template<typename scalarType> constexpr void operator/=(const scalarType &scalar) {
         static_assert(Rows > 0 && Columns > 0, "Matrix-scalar division is not defined for zero-dimensional matrices.");
         for(int i=0; i < Rows * Columns; i++) elements[i] /= scalar;
     }
 
-    inline ElementType operator()(int i, int j) const {
-        if (i >= Rows)
-            throw std::out_of_range("Row index out of range");
-        if (j >= Columns)
-            throw std::out_of_range("Column index out of range");
+    constexpr ElementType operator()(int i, int j) const {
+        MATH_CHECK_INDEX(i < Rows, "Row index out of range");
+        MATH_CHECK_INDEX(j < Columns, "Column index out of range");
         return elements[i * Columns + j];
     }
 
     // Non-const version for write access
-    inline ElementType& operator()(int i, int j) {
-        if (i >= Rows)
-            throw std::out_of_range("Row index out of range");
-        if (j >= Columns)
-            throw std::out_of_range("Column index out of range");
+    constexpr ElementType& operator()(int i, int j) {
+        MATH_CHECK_INDEX(i < Rows, "Row index out of range");
+        MATH_CHECK_INDEX(j < Columns, "Column index out of range");
         return elements[i * Columns + j];
     }
 
     // Matrix-matrix multiplication
     template<size_t OtherColumns>
-    Matrix<ElementType, Rows, OtherColumns> operator*(const Matrix<ElementType, Columns, OtherColumns> &other) const {
+    constexpr Matrix<ElementType, Rows, OtherColumns> operator*(const Matrix<ElementType, Columns, OtherColumns> &other) const {
         static_assert(Rows > 0 && Columns > 0 && OtherColumns > 0, "Matrix-matrix multiplication is not defined for zero-dimensional matrices.");
         Matrix<ElementType, Rows, OtherColumns> temp;
         for (size_t i = 0; i < Rows; i++) {
@@ -122,14 +120,25 @@ struct Matrix {
         return temp;
     }
 
+    // Rows become columns
+    constexpr Matrix<ElementType, Columns, Rows> Transposed() const {
+        Matrix<ElementType, Columns, Rows> temp;
+        for (size_t i = 0; i < Rows; i++) {
+            for (size_t j = 0; j < Columns; j++) {
+                temp.elements[j * Rows + i] = elements[i * Columns + j];
+            }
+        }
+        return temp;
+    }
+
     // Default constructor
-    Matrix() {
+    constexpr Matrix() {
         static_assert(Rows > 0 && Columns > 0, "Zero matrix is not defined for zero-dimensional matrices.");
         for(int i=0; i < Rows * Columns; i++) elements[i] = 0;
     }
 
     // Constructor from 2D array
-    Matrix(ElementType array[Rows][Columns]){
+    constexpr Matrix(ElementType array[Rows][Columns]){
         static_assert(Rows > 0 && Columns > 0, "Nonzero matrix is not defined for zero-dimensional matrices.");
         for(int i=0; i < Rows; i++){
             for(int j=0; j < Columns; j++){
@@ -139,12 +148,12 @@ struct Matrix {
     }
 
     // Constructor from 1D array
-    Matrix(ElementType array[Rows * Columns]) {
+    constexpr Matrix(ElementType array[Rows * Columns]) {
         static_assert(Rows > 0 && Columns > 0, "Nonzero matrix is not defined for zero-dimensional matrices.");
         for(int i=0; i < Rows * Columns; i++) elements[i] = array[i];
     }
 
-    Matrix(std::initializer_list<ElementType> init){
+    constexpr Matrix(std::initializer_list<ElementType> init){
         if(init.size() != Rows * Columns){
             throw std::runtime_error("invalid number of elements in initializer list");
         }
@@ -152,4 +161,6 @@ struct Matrix {
     }
 };
 
+#include "MatrixSIMD.h"
+
 #endif
\ No newline at end of file
@@ -0,0 +1,98 @@
+// SSE versions of the 4x4 float operations that run per vertex and per frame.
+// Intrinsics can't run at compile time, so constant evaluation takes the same loops as the generic versions.
+// Included at the end of Matrix.h and Vector.h, each part is declared once both types it needs are complete.
+// The generic loops stay the reference: every sum here is 0 plus the products in the same order as the loops,
+// multiplied then added without fused multiply-add, so the results are bit-identical to them
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#ifndef MATRIX_SIMD_SSE
+#define MATRIX_SIMD_SSE
+#include <immintrin.h>
+#include <type_traits>
+#endif
+#endif
+
+
+#if defined(MATRIX_SIMD_SSE) && defined(MATRIX_H) && !defined(MATRIX_SIMD_MATRIX_H)
+#define MATRIX_SIMD_MATRIX_H
+
+// row i of the product is the rows of other scaled by row i of this
+template<> template<>
+constexpr Matrix<float, 4, 4> Matrix<float, 4, 4>::operator*<4>(const Matrix<float, 4, 4> &other) const {
+    Matrix<float, 4, 4> temp;
+    if (std::is_constant_evaluated()) {
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                float sum = 0;
+                for (int k = 0; k < 4; k++) sum += elements[i * 4 + k] * other.elements[k * 4 + j];
+                temp.elements[i * 4 + j] = sum;
+            }
+        }
+        return temp;
+    }
+
+    const __m128 otherRows[4] = {
+        _mm_load_ps(other.elements.data()), _mm_load_ps(other.elements.data() + 4),
+        _mm_load_ps(other.elements.data() + 8), _mm_load_ps(other.elements.data() + 12)
+    };
+    for (int i = 0; i < 4; i++) {
+        const __m128 row = _mm_load_ps(elements.data() + i * 4);
+        __m128 sum = _mm_add_ps(_mm_setzero_ps(), _mm_mul_ps(_mm_shuffle_ps(row, row, 0x00), otherRows[0]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, 0x55), otherRows[1]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, 0xAA), otherRows[2]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, 0xFF), otherRows[3]));
+        _mm_store_ps(temp.elements.data() + i * 4, sum);
+    }
+    return temp;
+}
+
+template<>
+constexpr Matrix<float, 4, 4> Matrix<float, 4, 4>::Transposed() const {
+    Matrix<float, 4, 4> temp;
+    if (std::is_constant_evaluated()) {
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) temp.elements[j * 4 + i] = elements[i * 4 + j];
+        }
+        return temp;
+    }
+
+    __m128 row0 = _mm_load_ps(elements.data()), row1 = _mm_load_ps(elements.data() + 4);
+    __m128 row2 = _mm_load_ps(elements.data() + 8), row3 = _mm_load_ps(elements.data() + 12);
+    _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+    _mm_store_ps(temp.elements.data(), row0);
+    _mm_store_ps(temp.elements.data() + 4, row1);
+    _mm_store_ps(temp.elements.data() + 8, row2);
+    _mm_store_ps(temp.elements.data() + 12, row3);
+    return temp;
+}
+
+#endif
+
+
+#if defined(MATRIX_SIMD_SSE) && defined(MATRIX_H) && defined(VECTOR_H) && !defined(MATRIX_SIMD_VECTOR_H)
+#define MATRIX_SIMD_VECTOR_H
+
+// the matrix columns scaled by the components, Vector<float, 3> points go through this as (x, y, z, 1)
+template<> template<>
+constexpr Vector<float, 4> Vector<float, 4>::operator*<float>(const Matrix<float, 4, 4> &matrix) const {
+    Vector<float, 4> temp;
+    if (std::is_constant_evaluated()) {
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) temp.components[i] += matrix.elements[i * 4 + j] * components[j];
+        }
+        return temp;
+    }
+
+    __m128 column0 = _mm_load_ps(matrix.elements.data()), column1 = _mm_load_ps(matrix.elements.data() + 4);
+    __m128 column2 = _mm_load_ps(matrix.elements.data() + 8), column3 = _mm_load_ps(matrix.elements.data() + 12);
+    _MM_TRANSPOSE4_PS(column0, column1, column2, column3);
+
+    __m128 sum = _mm_add_ps(_mm_setzero_ps(), _mm_mul_ps(column0, _mm_set1_ps(components[0])));
+    sum = _mm_add_ps(sum, _mm_mul_ps(column1, _mm_set1_ps(components[1])));
+    sum = _mm_add_ps(sum, _mm_mul_ps(column2, _mm_set1_ps(components[2])));
+    sum = _mm_add_ps(sum, _mm_mul_ps(column3, _mm_set1_ps(components[3])));
+    _mm_store_ps(temp.components.data(), sum);
+    return temp;
+}
+
+#endif
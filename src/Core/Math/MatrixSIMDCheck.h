@@ -0,0 +1,121 @@
+#ifndef MATRIX_SIMD_CHECK_H
+#define MATRIX_SIMD_CHECK_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include "Vector.h"
+#include "Matrix.h"
+#include "../Utilities/MathFunctions.h"
+
+
+// Runs the 4x4 float operations MatrixSIMD.h specializes on random inputs next to the loops the generic
+// templates run, written out here since the specializations replace them. The SSE versions promise
+// bit-identical results, so any difference at all counts. With FMA enabled (-mfma, -march=native) the compiler
+// may fuse the loops' multiply-adds and round differently, then results only have to agree to a few ulps.
+// Cheap enough to run once at startup in debug builds
+namespace MatrixSIMDCheck {
+
+    using Matrix4x4F = Matrix<float, 4, 4>;
+    using Vector4F = Vector<float, 4>;
+
+    // xorshift, floats in [-range, range)
+    struct Random {
+        uint32_t state;
+
+        float Next(float range) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return (state >> 8) * (2.0f * range / 16777216.0f) - range;
+        }
+    };
+
+#ifdef __FMA__
+    constexpr float tolerance = 1e-5f;     // relative to the result's largest element
+#else
+    constexpr float tolerance = 0.0f;
+#endif
+
+    template <size_t Count>
+    bool Differs(const std::array<float, Count>& result, const std::array<float, Count>& expected) {
+        if (tolerance == 0.0f) return memcmp(result.data(), expected.data(), sizeof(result)) != 0;
+
+        float scale = 1.0f;
+        for (float element : expected) scale = std::max(scale, fabsf(element));
+        for (size_t i = 0; i < Count; i++) {
+            if (!(fabsf(result[i] - expected[i]) <= tolerance * scale)) return true;
+        }
+        return false;
+    }
+
+    inline Matrix4x4F MultiplyGeneric(const Matrix4x4F& left, const Matrix4x4F& right) {
+        Matrix4x4F product;
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                float sum = 0;
+                for (int k = 0; k < 4; k++) sum += left.elements[i * 4 + k] * right.elements[k * 4 + j];
+                product.elements[i * 4 + j] = sum;
+            }
+        }
+        return product;
+    }
+
+    inline Vector4F MultiplyGeneric(const Vector4F& vector, const Matrix4x4F& matrix) {
+        Vector4F product;
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) product.components[i] += matrix.elements[i * 4 + j] * vector.components[j];
+        }
+        return product;
+    }
+
+    inline Matrix4x4F TransposeGeneric(const Matrix4x4F& matrix) {
+        Matrix4x4F transposed;
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) transposed.elements[j * 4 + i] = matrix.elements[i * 4 + j];
+        }
+        return transposed;
+    }
+
+    // the scalar QuickMatrixInverse: rotation transposed, translation -rotation^T * translation
+    inline Matrix4x4F QuickMatrixInverseGeneric(const Matrix4x4F& input) {
+        Matrix4x4F output;
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) output.elements[i * 4 + j] = input.elements[j * 4 + i];
+        }
+        for (int i = 0; i < 3; i++) {
+            float sum = 0.0f;
+            for (int j = 0; j < 3; j++) sum += output.elements[i * 4 + j] * input.elements[j * 4 + 3];
+            output.elements[i * 4 + 3] = -sum;
+        }
+        output.elements[15] = 1.0f;
+        return output;
+    }
+
+    // how many of the samples * 4 results differ from the generic ones
+    inline size_t CountMismatches(int samples, uint32_t seed = 1) {
+        Random random = { seed ? seed : 1 };
+        size_t mismatches = 0;
+
+        for (int sample = 0; sample < samples; sample++) {
+            Matrix4x4F left, right;
+            Vector4F vector;
+            for (float& element : left.elements) element = random.Next(10.0f);
+            for (float& element : right.elements) element = random.Next(10.0f);
+            for (float& component : vector.components) component = random.Next(10.0f);
+
+            mismatches += Differs((left * right).elements, MultiplyGeneric(left, right).elements);
+            mismatches += Differs((vector * left).components, MultiplyGeneric(vector, left).components);
+            mismatches += Differs(left.Transposed().elements, TransposeGeneric(left).elements);
+
+            // only meant for rotation and translation matrices
+            Matrix4x4F rigid = MathFunctions::Matrices::CreateTranslationMatrix(random.Next(10.0f), random.Next(10.0f), random.Next(10.0f)) *
+                               MathFunctions::Matrices::CreateRotationMatrix(random.Next(3.2f), random.Next(3.2f), random.Next(3.2f));
+            mismatches += Differs(MathFunctions::Matrices::QuickMatrixInverse(rigid).elements, QuickMatrixInverseGeneric(rigid).elements);
+        }
+        return mismatches;
+    }
+}
+
+#endif
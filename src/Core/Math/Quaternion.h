@@ -8,29 +8,29 @@ template <typename ComponentType>
 struct Quaternion {
     ComponentType components[4];
 
-    bool IsZero() {
+    constexpr bool IsZero() const {
         for(int i=0; i < 4; i++) if(components[i] != 0) return false;
         return true;
     }
 
-    Quaternion(const ComponentType &a, const ComponentType &b,
-               const ComponentType &c, const ComponentType &d) {
+    constexpr Quaternion(const ComponentType &a, const ComponentType &b,
+                         const ComponentType &c, const ComponentType &d) {
         static_assert(sizeof(ComponentType) > 0, "ComponentType must be a valid type.");
         ComponentType array[4] = {a,b,c,d};
         for(int i=0; i < 4; i++) components[i] = array[i];
     }
 
-    Quaternion(ComponentType array[4]) {
+    constexpr Quaternion(ComponentType array[4]) {
         static_assert(sizeof(ComponentType) > 0, "ComponentType must be a valid type.");
         for(int i=0; i < 4; i++) components[i] = array[i];
     }
 
-    Quaternion() {
+    constexpr Quaternion() {
         static_assert(sizeof(ComponentType) > 0, "ComponentType must be a valid type.");
         for(int i=0; i < 4; i++) components[i] = 0;
     }
 
-    Quaternion operator*(const Quaternion &other) const {
+    constexpr Quaternion operator*(const Quaternion &other) const {
         static_assert(sizeof(ComponentType) > 0, "ComponentType must be a valid type.");
         ComponentType a1 = components[0];
         ComponentType b1 = components[1];
@@ -50,7 +50,7 @@ struct Quaternion {
         );
     }
 
-    Quaternion operator+(const Quaternion &other) const {
+    constexpr Quaternion operator+(const Quaternion &other) const {
         static_assert(sizeof(ComponentType) > 0, "ComponentType must be a valid type.");
         Quaternion result = *this;
         for(int i=0; i < 4; i++) result.components[i] += other.components[i];
@@ -58,24 +58,24 @@ struct Quaternion {
     }
 
     // Unary minus operator aka negation
-    void operator-() {
+    constexpr void operator-() {
         static_assert(sizeof(ComponentType) > 0, "ComponentType must be a valid type.");
         for(int i=0; i < 4; i++) components[i] = -components[i];
     }
 
-    Quaternion operator/(float scalar) const {
+    constexpr Quaternion operator/(float scalar) const {
         static_assert(sizeof(ComponentType) > 0, "ComponentType must be a valid type.");
         Quaternion result = *this;
         for(int i=0; i < 4; i++) result.components[i] /= scalar;
         return result;
     }
 
-    void operator/=(float scalar) {
+    constexpr void operator/=(float scalar) {
         static_assert(sizeof(ComponentType) > 0, "ComponentType must be a valid type.");
         for(int i=0; i < 4; i++) components[i] /= scalar;
     }
 
-    ComponentType SquaredLength() const {
+    constexpr ComponentType SquaredLength() const {
         static_assert(sizeof(ComponentType) > 0, "ComponentType must be a valid type.");
         if (IsZero()) return 0;
         float sum = 0;
@@ -3,6 +3,9 @@
 #include <array>
 #include <vector>
 #include <stdexcept>
+#include <utility>
+#include "BoundsCheck.h"
+#include "VectorExpression.h"
 
 #ifndef MATRIX_H
 template <typename ElementType, size_t Rows, size_t Columns> struct Matrix;
@@ -16,29 +19,26 @@ template <typename ComponentType> struct Quaternion;
 #define VECTOR_H
 
 template <typename ComponentType, size_t Dimensions>
-struct Vector {
-    std::array<ComponentType, Dimensions> components;
+struct Vector : VectorExpression<Vector<ComponentType, Dimensions>, ComponentType, Dimensions> {
+    // 4 floats are aligned to 16 so MatrixSIMD.h can load them directly
+    alignas(sizeof(ComponentType) * Dimensions == 16 ? 16 : alignof(ComponentType)) std::array<ComponentType, Dimensions> components;
     using VectorN = Vector<ComponentType, Dimensions>;
     using Vector3 = Vector<ComponentType, 3>;
 
 
-    ComponentType& operator[](int index) {   //for element assignment; e.g. |Vector[i] = k|
-        if (index >= Dimensions) {
-            throw std::out_of_range("Index out of range");
-        }
+    constexpr ComponentType& operator[](int index) {   //for element assignment; e.g. |Vector[i] = k|
+        MATH_CHECK_INDEX(index < Dimensions, "Index out of range");
         return components[index];
     }
 
-    ComponentType operator[](int index) const {  //for retrieving value without assignment; e.g. |return Vector[i]|
-        if (index >= Dimensions) {
-            throw std::out_of_range("Index out of range");
-        }
+    constexpr ComponentType operator[](int index) const {  //for retrieving value without assignment; e.g. |return Vector[i]|
+        MATH_CHECK_INDEX(index < Dimensions, "Index out of range");
         return components[index];
     }
 
 
     // matrix-vector multiplication
-    template<typename MatrixType> VectorN operator*(const Matrix<MatrixType, Dimensions, Dimensions> &matrix) const {
+    template<typename MatrixType> constexpr VectorN operator*(const Matrix<MatrixType, Dimensions, Dimensions> &matrix) const {
         static_assert(Dimensions > 0, "Matrix-vector multiplication is not defined for zero-dimensional vectors.");
         VectorN temp;
         for(int i=0; i < Dimensions; i++) {
@@ -50,20 +50,14 @@ struct Vector {
     }
 
     // matrix-vector multiplication
-    template<typename MatrixType> void operator*=(const Matrix<MatrixType, Dimensions, Dimensions> &matrix) {
+    template<typename MatrixType> constexpr void operator*=(const Matrix<MatrixType, Dimensions, Dimensions> &matrix) {
         static_assert(Dimensions > 0, "Matrix-vector multiplication is not defined for zero-dimensional vectors.");
-        VectorN temp;
-        for(int i=0; i < Dimensions; i++) {
-            for(int j=0; j < Dimensions; j++) {
-                temp.components[i] += matrix.components[i * Dimensions + j] * this->components[j];
-            }
-        }
-        *this = temp;
+        *this = *this * matrix;
     }
 
     //Apply a rotation stored in unit quaternion to a 3D vector
     template<typename QuaternionType>
-    void RotateByQuaternion(const QuaternionType &quaternion) {
+    constexpr void RotateByQuaternion(const QuaternionType &quaternion) {
         static_assert(Dimensions == 3, "Rotation by quaternion is only defined for 3D vectors.");
 
         QuaternionType q = quaternion;
@@ -92,77 +86,49 @@ struct Vector {
     }
 
     // change all components of a vector to coresponding array element values
-    void operator=(const ComponentType array[Dimensions]) {
+    constexpr void operator=(const ComponentType array[Dimensions]) {
         for(int i=0; i<Dimensions; i++){
             components[i] = array[i];
         }
     }
 
     // change all components of a vector to coresponding components of another vector
-    void operator=(const VectorN& other) {
+    constexpr void operator=(const VectorN& other) {
         for(int i=0; i<Dimensions; i++){
             components[i] = other.components[i];
         }
     }
 
-    // vector addition just means adding corresponding coords 
-    Vector operator+(const VectorN &other) const {
-        static_assert(Dimensions > 0, "Vector addition is not defined for zero-dimensional vectors.");
-        Vector<ComponentType,Dimensions> temp;
-        for(int i=0; i < Dimensions; i++) temp.components[i] = components[i] + other.components[i];
-        return temp;
+    // evaluate a lazy expression (a + b, a * k, ...) into this vector, see VectorExpression.h
+    template<typename Expression>
+    constexpr void operator=(const VectorExpression<Expression, ComponentType, Dimensions>& expression) {
+        components = EvaluateComponents(static_cast<const Expression&>(expression), std::make_index_sequence<Dimensions>());
     }
 
     // addition with assignment
-    void operator+=(const VectorN &other) {
+    template<typename Expression>
+    constexpr void operator+=(const VectorExpression<Expression, ComponentType, Dimensions> &other) {
         static_assert(Dimensions > 0, "Vector addition is not defined for zero-dimensional vectors.");
-        for(int i=0; i < Dimensions; i++) components[i] += other.components[i];
-    }
-
-    // unary minus, basically vector negation
-    Vector operator-() const {
-        static_assert(Dimensions > 0, "Vector negation is not defined for zero-dimensional vectors.");
-        VectorN temp;
-        for(int i=0; i < Dimensions; i++) temp.components[i] = -components[i];
-        return temp;
-    }
-
-    // actual vector subtraction is basically addition of a negated vector
-    Vector operator-(const VectorN &other) const {
-        static_assert(Dimensions > 0, "Vector subtraction is not defined for zero-dimensional vectors.");
-        return (*this) + (-other);
+        const Expression& source = static_cast<const Expression&>(other);
+        for(int i=0; i < Dimensions; i++) components[i] += source[i];
     }
 
     // subtraction with assignment
-    void operator-=(const VectorN &other) {
+    template<typename Expression>
+    constexpr void operator-=(const VectorExpression<Expression, ComponentType, Dimensions> &other) {
         static_assert(Dimensions > 0, "Vector addition is not defined for zero-dimensional vectors.");
-        for(int i=0; i < Dimensions; i++) components[i] -= other.components[i];
-    }
-
-    // vector scaling
-    template<typename scalarType> VectorN operator*(const scalarType &scalar) const {
-        static_assert(Dimensions > 0, "Vector scaling is not defined for zero-dimensional vectors.");
-        VectorN temp;
-        for(int i=0; i < Dimensions; i++) temp.components[i] = components[i] * scalar;
-        return temp;
+        const Expression& source = static_cast<const Expression&>(other);
+        for(int i=0; i < Dimensions; i++) components[i] -= source[i];
     }
 
     // vector scaling with assignment
-    template<typename scalarType> void operator*=(const scalarType &scalar) {
+    template<typename scalarType> constexpr void operator*=(const scalarType &scalar) {
         static_assert(Dimensions > 0, "Vector scaling is not defined for zero-dimensional vectors.");
         for(int i=0; i < Dimensions; i++) components[i] *= scalar;
     }
 
-    // vector scaling 2
-    template<typename scalarType> Vector<ComponentType,Dimensions> operator/(const scalarType &scalar) const {
-        static_assert(Dimensions > 0, "Vector scaling is not defined for zero-dimensional vectors.");
-        VectorN temp;
-        for(int i=0; i < Dimensions; i++) temp.components[i] = components[i] / scalar;
-        return temp;
-    }
-
     // vector scaling 2 with assignment
-    template<typename scalarType> void operator/=(const scalarType &scalar) {
+    template<typename scalarType> constexpr void operator/=(const scalarType &scalar) {
         static_assert(Dimensions > 0, "Vector scaling is not defined for zero-dimensional vectors.");
         for(int i=0; i < Dimensions; i++) components[i] /= scalar;
     }
@@ -178,24 +144,24 @@ struct Vector {
     }
 
     // sum of a vector's squared components is its length squared
-    ComponentType SquaredComponentSum() const {
+    constexpr ComponentType SquaredComponentSum() const {
         static_assert(Dimensions > 0, "Squared component sum is not defined for zero-dimensional vectors.");
         ComponentType squaredComponentSum = 0;
         for(int i=0; i < Dimensions; i++) squaredComponentSum += components[i] * components[i];
         return squaredComponentSum;
     }
 
-    ComponentType LengthSquared() const {
+    constexpr ComponentType LengthSquared() const {
         return this->SquaredComponentSum();
     }
 
-    ComponentType MagnitudeSquared() const {
+    constexpr ComponentType MagnitudeSquared() const {
         return this->SquaredComponentSum();
     }
 
     // dot product of two vectors
-    template<int OtherVectorDimensions>
-    ComponentType operator*(const Vector<ComponentType, OtherVectorDimensions> &other) const {
+    template<size_t OtherVectorDimensions>
+    constexpr ComponentType operator*(const Vector<ComponentType, OtherVectorDimensions> &other) const {
         static_assert(Dimensions > 0, "Dot product is not defined for zero-dimensional vectors.");
         static_assert(OtherVectorDimensions > 0, "Dot product is not defined for zero-dimensional vectors.");
         static_assert(OtherVectorDimensions >= Dimensions, "Vector B needs to have dimensions >= to those of Vector A for dot product");
@@ -205,6 +171,15 @@ struct Vector {
         return dotProduct;
     }
 
+    // dot product with a lazy expression, e.g. normal * (b - a)
+    template<typename Expression, typename = std::enable_if_t<!VectorExpressions::IsVector<Expression>::value>>
+    constexpr ComponentType operator*(const VectorExpression<Expression, ComponentType, Dimensions> &other) const {
+        const Expression& source = static_cast<const Expression&>(other);
+        ComponentType dotProduct = 0;
+        for(int i=0; i < Dimensions; i++) dotProduct+= components[i] * source[i];
+        return dotProduct;
+    }
+
     // cross product
     Vector3 operator%(const Vector<ComponentType,Dimensions> &other) const {
         static_assert(Dimensions == 3, "Cross product is only defined for 3D vectors.");
@@ -220,14 +195,14 @@ struct Vector {
         return Vector3({v2*w3 - v3*w2, v3*w1 - v1*w3, v1*w2 - v2*w1});
     }
 
-    ComponentType ComponentSum() const {
+    constexpr ComponentType ComponentSum() const {
         static_assert(Dimensions > 0, "Component sum is not defined for zero-dimensional vectors.");
         ComponentType sum = 0;
         for(int i=0; i < Dimensions; i++) sum += components[i];
         return sum;
     }
 
-    inline bool IsZero() const {
+    constexpr bool IsZero() const {
         return this->ComponentSum() == 0;
     }
 
@@ -252,38 +227,53 @@ struct Vector {
     }
 
 
+    private:
+        // Every component is read before any is written, so the expression may reference this vector, and
+        // the components are spelled out rather than looped so the compiler keeps them all in registers
+        template<typename Expression, size_t... Indices>
+        static constexpr std::array<ComponentType, Dimensions> EvaluateComponents(const Expression& source, std::index_sequence<Indices...>) {
+            return { static_cast<ComponentType>(source[Indices])... };
+        }
+
+    public:
     // N dimensional zero vector constructor
-    Vector() {
+    constexpr Vector() {
         static_assert(Dimensions > 0, "Zero vector is not defined for zero-dimensional vectors.");
         for(int i=0; i < Dimensions; i++) components[i] = 0;
     }
 
     // N dimensional nonzero vector constructor
-    Vector(ComponentType _components[Dimensions]) {
+    constexpr Vector(ComponentType _components[Dimensions]) {
         static_assert(Dimensions > 0, "Nonzero vector is not defined for zero-dimensional vectors.");
         for(int i=0; i < Dimensions; i++) components[i] = _components[i];
     }
 
     // N dimensional nonzero vector constructor
-    Vector(std::array<ComponentType, Dimensions> _components) {
+    constexpr Vector(std::array<ComponentType, Dimensions> _components) {
         static_assert(Dimensions > 0, "Nonzero vector is not defined for zero-dimensional vectors.");
         for(int i=0; i < Dimensions; i++) components[i] = _components[i];
     }
 
     // templated copy constructor
     template<typename OtherComponentType>
-    Vector<ComponentType, Dimensions> (const Vector<OtherComponentType, Dimensions> &other){
+    constexpr Vector(const Vector<OtherComponentType, Dimensions> &other){
         static_assert(Dimensions > 0, "Copy constructor is not defined for zero-dimensional vectors.");
         for(int i=0; i < Dimensions; i++) this->components[i] = other.components[i];
     }
 
-    template <typename... Args>
-    explicit Vector(Args... args) {
+    // the components evaluated from a lazy expression
+    template<typename Expression>
+    constexpr Vector(const VectorExpression<Expression, ComponentType, Dimensions> &expression) {
+        components = EvaluateComponents(static_cast<const Expression&>(expression), std::make_index_sequence<Dimensions>());
+    }
+
+    template <typename... Args, typename = std::enable_if_t<(std::is_arithmetic<Args>::value && ...)>>
+    constexpr explicit Vector(Args... args) {
         static_assert(sizeof...(Args) == Dimensions, "Wrong number of arguments");
         components = {static_cast<ComponentType>(args)...};
     }
 
-    Vector(std::initializer_list<ComponentType> init) {
+    constexpr Vector(std::initializer_list<ComponentType> init) {
         if (init.size() != Dimensions) {
             throw std::invalid_argument("Wrong number of arguments in initializer list");
         }
@@ -292,4 +282,6 @@ struct Vector {
 
 };
 
+#include "MatrixSIMD.h"
+
 #endif
\ No newline at end of file
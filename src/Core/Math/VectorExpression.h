@@ -0,0 +1,108 @@
+#ifndef VECTOR_EXPRESSION_H
+#define VECTOR_EXPRESSION_H
+
+#include <stddef.h>
+#include <type_traits>
+
+template <typename ComponentType, size_t Dimensions> struct Vector;
+
+
+// Component-wise vector arithmetic is lazy: a + (b - a) * t builds a small tree of the nodes below and
+// assigning it to a Vector runs one loop over the components, with no Vector made for each step.
+// Every node rounds to ComponentType like the eager operators did, so results are the same.
+// Vectors are held by reference, so an expression must not outlive the vectors in it: assign it to a Vector,
+// don't keep it in an auto
+template <typename Expression, typename ComponentType, size_t Dimensions>
+struct VectorExpression {
+    constexpr ComponentType operator[](size_t index) const { return static_cast<const Expression&>(*this)[index]; }
+
+    constexpr Vector<ComponentType, Dimensions> Evaluate() const { return Vector<ComponentType, Dimensions>(*this); }
+
+    // the non component-wise operations need a whole vector first
+    constexpr ComponentType operator*(const Vector<ComponentType, Dimensions> &other) const { return Evaluate() * other; }
+    constexpr Vector<ComponentType, 3> operator%(const Vector<ComponentType, Dimensions> &other) const { return Evaluate() % other; }
+    double Length() const { return Evaluate().Length(); }
+    Vector<ComponentType, Dimensions> Unit() const { return Evaluate().Unit(); }
+};
+
+
+namespace VectorExpressions {
+
+    template <typename Expression> struct IsVector : std::false_type {};
+    template <typename ComponentType, size_t Dimensions> struct IsVector<Vector<ComponentType, Dimensions>> : std::true_type {};
+
+    // vectors are referenced, intermediate nodes are small and copied
+    template <typename Expression>
+    struct Operand { using Type = std::conditional_t<IsVector<Expression>::value, const Expression&, Expression>; };
+
+    template <typename Left, typename Right, typename Operation, typename ComponentType, size_t Dimensions>
+    struct Binary : VectorExpression<Binary<Left, Right, Operation, ComponentType, Dimensions>, ComponentType, Dimensions> {
+        typename Operand<Left>::Type left;
+        typename Operand<Right>::Type right;
+
+        constexpr Binary(const Left& left, const Right& right) : left(left), right(right) {}
+        constexpr ComponentType operator[](size_t index) const { return Operation::Apply(left[index], right[index]); }
+    };
+
+    template <typename Left, typename Scalar, typename Operation, typename ComponentType, size_t Dimensions>
+    struct WithScalar : VectorExpression<WithScalar<Left, Scalar, Operation, ComponentType, Dimensions>, ComponentType, Dimensions> {
+        typename Operand<Left>::Type left;
+        Scalar scalar;
+
+        constexpr WithScalar(const Left& left, const Scalar& scalar) : left(left), scalar(scalar) {}
+        constexpr ComponentType operator[](size_t index) const { return Operation::Apply(left[index], scalar); }
+    };
+
+    template <typename Inner, typename ComponentType, size_t Dimensions>
+    struct Negation : VectorExpression<Negation<Inner, ComponentType, Dimensions>, ComponentType, Dimensions> {
+        typename Operand<Inner>::Type inner;
+
+        constexpr explicit Negation(const Inner& inner) : inner(inner) {}
+        constexpr ComponentType operator[](size_t index) const { return -inner[index]; }
+    };
+
+    // the scalar operations compute in the scalar's type (double for a double) and round once, like the loops did
+    template <typename ComponentType>
+    struct Add { template <typename A, typename B> static constexpr ComponentType Apply(A a, B b) { return a + b; } };
+    template <typename ComponentType>
+    struct Subtract { template <typename A, typename B> static constexpr ComponentType Apply(A a, B b) { return a - b; } };
+    template <typename ComponentType>
+    struct Multiply { template <typename A, typename B> static constexpr ComponentType Apply(A a, B b) { return a * b; } };
+    template <typename ComponentType>
+    struct Divide { template <typename A, typename B> static constexpr ComponentType Apply(A a, B b) { return a / b; } };
+}
+
+
+template <typename Left, typename Right, typename ComponentType, size_t Dimensions>
+constexpr VectorExpressions::Binary<Left, Right, VectorExpressions::Add<ComponentType>, ComponentType, Dimensions>
+operator+(const VectorExpression<Left, ComponentType, Dimensions> &left, const VectorExpression<Right, ComponentType, Dimensions> &right) {
+    return { static_cast<const Left&>(left), static_cast<const Right&>(right) };
+}
+
+template <typename Left, typename Right, typename ComponentType, size_t Dimensions>
+constexpr VectorExpressions::Binary<Left, Right, VectorExpressions::Subtract<ComponentType>, ComponentType, Dimensions>
+operator-(const VectorExpression<Left, ComponentType, Dimensions> &left, const VectorExpression<Right, ComponentType, Dimensions> &right) {
+    return { static_cast<const Left&>(left), static_cast<const Right&>(right) };
+}
+
+template <typename Inner, typename ComponentType, size_t Dimensions>
+constexpr VectorExpressions::Negation<Inner, ComponentType, Dimensions>
+operator-(const VectorExpression<Inner, ComponentType, Dimensions> &inner) {
+    return VectorExpressions::Negation<Inner, ComponentType, Dimensions>(static_cast<const Inner&>(inner));
+}
+
+template <typename Left, typename Scalar, typename ComponentType, size_t Dimensions,
+          typename = std::enable_if_t<std::is_arithmetic<Scalar>::value>>
+constexpr VectorExpressions::WithScalar<Left, Scalar, VectorExpressions::Multiply<ComponentType>, ComponentType, Dimensions>
+operator*(const VectorExpression<Left, ComponentType, Dimensions> &left, const Scalar &scalar) {
+    return { static_cast<const Left&>(left), scalar };
+}
+
+template <typename Left, typename Scalar, typename ComponentType, size_t Dimensions,
+          typename = std::enable_if_t<std::is_arithmetic<Scalar>::value>>
+constexpr VectorExpressions::WithScalar<Left, Scalar, VectorExpressions::Divide<ComponentType>, ComponentType, Dimensions>
+operator/(const VectorExpression<Left, ComponentType, Dimensions> &left, const Scalar &scalar) {
+    return { static_cast<const Left&>(left), scalar };
+}
+
+#endif
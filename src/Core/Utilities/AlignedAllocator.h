@@ -0,0 +1,45 @@
+#ifndef ALIGNED_ALLOCATOR_H
+#define ALIGNED_ALLOCATOR_H
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <new>
+
+
+// std::allocator replacement that hands out memory aligned to Alignment bytes,
+// e.g. |std::vector<uint32_t, AlignedAllocator<uint32_t, 64>>| for cache line aligned buffers
+template <typename Type, size_t Alignment>
+struct AlignedAllocator {
+    static_assert((Alignment & (Alignment - 1)) == 0, "Alignment must be a power of two.");
+    static_assert(Alignment >= alignof(Type), "Alignment can't be weaker than the natural alignment of the type.");
+
+    using value_type = Type;
+
+    template <typename OtherType>
+    struct rebind { using other = AlignedAllocator<OtherType, Alignment>; };
+
+    AlignedAllocator() noexcept {}
+
+    template <typename OtherType>
+    AlignedAllocator(const AlignedAllocator<OtherType, Alignment>&) noexcept {}
+
+    Type* allocate(size_t count) {
+        // aligned_alloc wants the size to be a multiple of the alignment
+        size_t bytes = (count * sizeof(Type) + Alignment - 1) & ~(Alignment - 1);
+        void* memory = aligned_alloc(Alignment, bytes);
+        if (!memory) throw std::bad_alloc();
+        return static_cast<Type*>(memory);
+    }
+
+    void deallocate(Type* memory, size_t) noexcept {
+        free(memory);
+    }
+
+    template <typename OtherType>
+    bool operator==(const AlignedAllocator<OtherType, Alignment>&) const noexcept { return true; }
+
+    template <typename OtherType>
+    bool operator!=(const AlignedAllocator<OtherType, Alignment>&) const noexcept { return false; }
+};
+
+#endif
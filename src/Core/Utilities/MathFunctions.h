@@ -3,10 +3,68 @@
 
 
 #include <math.h>
+#include <stddef.h>
+#include <algorithm>
+#include <type_traits>
+#include <span>
 #include "../../Core/Math/Matrix.h"
+#include "../../Core/Math/Vector.h"
+#include "../../Core/Math/Quaternion.h"
 
 
 namespace MathFunctions{
+    namespace Scalars {
+        // tanf at run time. tanf isn't constexpr, so constant evaluation sums the sine and cosine series in double,
+        // which stays within an ulp of tanf below a quarter turn
+        constexpr float Tan(float radians) {
+            if (!std::is_constant_evaluated()) return tanf(radians);
+            double x = radians, sine = 0.0, cosine = 0.0, sineTerm = x, cosineTerm = 1.0;
+            for (int n = 0; n < 20; n++) {
+                sine += sineTerm;
+                cosine += cosineTerm;
+                sineTerm *= -x * x / ((2 * n + 2) * (2 * n + 3));
+                cosineTerm *= -x * x / ((2 * n + 1) * (2 * n + 2));
+            }
+            return static_cast<float>(sine / cosine);
+        }
+    }
+
+    namespace Quaternions {
+        // the same rotation as Matrices::CreateRotationMatrix(xAngle, yAngle, zAngle)
+        inline Quaternion<float> FromEulerAngles(float xAngle, float yAngle, float zAngle) {
+            Quaternion<float> x(cosf(xAngle * 0.5f), sinf(xAngle * 0.5f), 0.0f, 0.0f);
+            Quaternion<float> y(cosf(yAngle * 0.5f), 0.0f, sinf(yAngle * 0.5f), 0.0f);
+            Quaternion<float> z(cosf(zAngle * 0.5f), 0.0f, 0.0f, sinf(zAngle * 0.5f));
+            return x * y * z;
+        }
+
+        // Spherical interpolation of unit quaternions along the shorter arc, t = 0 gives a and 1 gives b
+        inline Quaternion<float> Slerp(const Quaternion<float>& a, const Quaternion<float>& b, float t) {
+            float cosine = 0.0f;
+            for (int i = 0; i < 4; i++) cosine += a.components[i] * b.components[i];
+            float sign = cosine < 0.0f ? -1.0f : 1.0f;
+            cosine *= sign;
+
+            // nearly the same rotation, the lerp is just as good and sin(angle) would divide by almost 0
+            float weightA = 1.0f - t, weightB = t;
+            if (cosine < 0.9995f) {
+                float angle = acosf(cosine);
+                weightA = sinf((1.0f - t) * angle) / sinf(angle);
+                weightB = sinf(t * angle) / sinf(angle);
+            }
+
+            Quaternion<float> result;
+            float length = 0.0f;
+            for (int i = 0; i < 4; i++) {
+                result.components[i] = weightA * a.components[i] + sign * weightB * b.components[i];
+                length += result.components[i] * result.components[i];
+            }
+            length = sqrtf(length);
+            for (int i = 0; i < 4; i++) result.components[i] /= length;
+            return result;
+        }
+    }
+
     namespace Polygons {
             
         template<typename ComponentType> bool IsPointInTriangle2D
@@ -152,8 +210,31 @@ namespace MathFunctions{
     namespace Matrices {
         using Matrix4x4F = Matrix<float,4,4>;
 
-        // Only for Rotation or Translation Matrices
-        Matrix4x4F QuickMatrixInverse(const Matrix4x4F &input){ 
+        // Only for Rotation or Translation Matrices: the rotation transposed, translation -rotation^T * translation
+        constexpr Matrix4x4F QuickMatrixInverse(const Matrix4x4F &input){ 
+#ifdef MATRIX_SIMD_SSE
+            if (!std::is_constant_evaluated()) {
+                const __m128 xyzMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+                __m128 row0 = _mm_and_ps(_mm_load_ps(input.elements.data()), xyzMask);
+                __m128 row1 = _mm_and_ps(_mm_load_ps(input.elements.data() + 4), xyzMask);
+                __m128 row2 = _mm_and_ps(_mm_load_ps(input.elements.data() + 8), xyzMask);
+
+                __m128 sum = _mm_add_ps(_mm_setzero_ps(), _mm_mul_ps(row0, _mm_set1_ps(input.elements[3])));
+                sum = _mm_add_ps(sum, _mm_mul_ps(row1, _mm_set1_ps(input.elements[7])));
+                sum = _mm_add_ps(sum, _mm_mul_ps(row2, _mm_set1_ps(input.elements[11])));
+                __m128 translation = _mm_xor_ps(sum, _mm_set1_ps(-0.0f));
+                translation = _mm_or_ps(_mm_and_ps(translation, xyzMask), _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f));
+
+                // transposing (R | 0) rows with the new translation as the last row gives (R^T | t) and (0, 0, 0, 1)
+                _MM_TRANSPOSE4_PS(row0, row1, row2, translation);
+                Matrix4x4F output;
+                _mm_store_ps(output.elements.data(), row0);
+                _mm_store_ps(output.elements.data() + 4, row1);
+                _mm_store_ps(output.elements.data() + 8, row2);
+                _mm_store_ps(output.elements.data() + 12, translation);
+                return output;
+            }
+#endif
             Matrix4x4F output;
             for(int i=0; i<3; i++){
                 for(int j=0; j<3; j++){
@@ -163,14 +244,15 @@ namespace MathFunctions{
             for(int i=0; i<3; i++){
                 float sum = 0.0f;
                 for(int j=0; j<3; j++){
-                    sum += output(3, j) * input(j, i);
+                    sum += output(i, j) * input(j, 3);
                 }
-                output(3, i) = -sum;
+                output(i, 3) = -sum;
             }
+            output(3, 3) = 1.0f;
             return output;
         }
 
-        Matrix4x4F CreateRotationMatrix(float xAngle, float yAngle, float zAngle){
+        inline Matrix4x4F CreateRotationMatrix(float xAngle, float yAngle, float zAngle){
             const Matrix4x4F rotationMatrix_X = {
                 1.0f,    0.0f,           0.0f,        0.0f,
                 0.0f,    cos(xAngle),   -sin(xAngle), 0.0f,
@@ -196,7 +278,7 @@ namespace MathFunctions{
 
         }
 
-        Matrix4x4F CreateTranslationMatrix(float translateX, float translateY, float translateZ) {
+        constexpr Matrix4x4F CreateTranslationMatrix(float translateX, float translateY, float translateZ) {
             return {
                 1.0f, 0.0f, 0.0f, translateX,
                 0.0f, 1.0f, 0.0f, translateY,
@@ -204,6 +286,205 @@ namespace MathFunctions{
                 0.0f, 0.0f, 0.0f, 1.0f
             };
         }
+
+        // Translation * rotation * scale without multiplying the three out, rotation has to be a unit quaternion
+        constexpr Matrix4x4F CreateTransformMatrix(const Vector<float, 3>& translation, const Quaternion<float>& rotation, const Vector<float, 3>& scale) {
+            const float w = rotation.components[0], x = rotation.components[1], y = rotation.components[2], z = rotation.components[3];
+            return {
+                (1.0f - 2.0f * (y * y + z * z)) * scale[0],   2.0f * (x * y - w * z) * scale[1],            2.0f * (x * z + w * y) * scale[2],            translation[0],
+                2.0f * (x * y + w * z) * scale[0],            (1.0f - 2.0f * (x * x + z * z)) * scale[1],   2.0f * (y * z - w * x) * scale[2],            translation[1],
+                2.0f * (x * z - w * y) * scale[0],            2.0f * (y * z + w * x) * scale[1],            (1.0f - 2.0f * (x * x + y * y)) * scale[2],   translation[2],
+                0.0f,                                         0.0f,                                         0.0f,                                         1.0f
+            };
+        }
+
+        constexpr Matrix4x4F CreateScaleMatrix(float scaleX, float scaleY, float scaleZ) {
+            return {
+                scaleX, 0.0f,   0.0f,   0.0f,
+                0.0f,   scaleY, 0.0f,   0.0f,
+                0.0f,   0.0f,   scaleZ, 0.0f,
+                0.0f,   0.0f,   0.0f,   1.0f
+            };
+        }
+
+        // Camera projection: fov in degrees. The camera looks down -z and w is view z, negative in front of it,
+        // so after the divide depth is f / (f - n) * (1 + n / distance): about 2 at the near plane, about 1 at
+        // the far plane and larger nearer the camera, which is the order the depth buffers compare in
+        constexpr Matrix4x4F CreateProjectionMatrix(float fov, float aspectRatio, float nearPlane, float farPlane) {
+            float fovRad = 1.0f / Scalars::Tan(fov * 0.5f * 3.14159f / 180.0f);
+            float q = 1.0f / (farPlane - nearPlane);
+
+            return {
+                aspectRatio * fovRad,   0.0f,          0.0f,              0.0f,
+                0.0f,                   fovRad,        0.0f,              0.0f,
+                0.0f,                   0.0f,          farPlane * q,     -q * farPlane * nearPlane,
+                0.0f,                   0.0f,          1.0f,              0.0f
+            };
+        }
+
+
+        // Batch transforms over contiguous arrays, 4 points per step with SSE and one at a time without.
+        // Points are rounded exactly like Vector<float, 4>(x, y, z, 1) * matrix, and output may be input itself
+        using Vector3F = Vector<float, 3>;
+        using Vector4F = Vector<float, 4>;
+        static_assert(sizeof(Vector3F) == 3 * sizeof(float), "the SSE paths read points as packed floats");
+
+        namespace Blocks {
+#ifdef MATRIX_SIMD_SSE
+            // 4 packed (x, y, z) points to one register per component and back
+            inline void LoadPoints(const float* points, __m128& x, __m128& y, __m128& z) {
+                __m128 a = _mm_loadu_ps(points), b = _mm_loadu_ps(points + 4), c = _mm_loadu_ps(points + 8);
+                x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+                y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+                z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+            }
+
+            inline void StorePoints(float* points, __m128 x, __m128 y, __m128 z) {
+                _mm_storeu_ps(points, _mm_shuffle_ps(_mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0)));
+                _mm_storeu_ps(points + 4, _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0)));
+                _mm_storeu_ps(points + 8, _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)), _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+            }
+
+            // one matrix row against 4 points, summed in the order Vector * Matrix uses
+            inline __m128 Row(const float* row, __m128 x, __m128 y, __m128 z) {
+                __m128 sum = _mm_add_ps(_mm_setzero_ps(), _mm_mul_ps(_mm_set1_ps(row[0]), x));
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(row[1]), y));
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(row[2]), z));
+                return _mm_add_ps(sum, _mm_set1_ps(row[3]));
+            }
+#endif
+
+            inline Vector4F Transform(const Vector3F& point, const Matrix4x4F& matrix) {
+                return Vector4F(point[0], point[1], point[2], 1.0f) * matrix;
+            }
+        }
+
+        // Affine: the bottom row of matrix is taken as (0, 0, 0, 1) and nothing is divided
+        inline void TransformPoints(std::span<const Vector3F> input, const Matrix4x4F& matrix, std::span<Vector3F> output) {
+            const size_t count = input.size();
+            size_t i = 0;
+#ifdef MATRIX_SIMD_SSE
+            const float* m = matrix.elements.data();
+            for (; i < (count & ~size_t(3)); i += 4) {
+                __m128 x, y, z;
+                Blocks::LoadPoints(input[i].components.data(), x, y, z);
+                Blocks::StorePoints(output[i].components.data(), Blocks::Row(m, x, y, z), Blocks::Row(m + 4, x, y, z), Blocks::Row(m + 8, x, y, z));
+            }
+#endif
+            for (; i < count; i++) {
+                Vector4F transformed = Blocks::Transform(input[i], matrix);
+                output[i] = Vector3F(transformed[0], transformed[1], transformed[2]);
+            }
+        }
+
+        // Projective: divided by w, points with w == 0 come out infinite
+        inline void TransformPointsProjective(std::span<const Vector3F> input, const Matrix4x4F& matrix, std::span<Vector3F> output) {
+            const size_t count = input.size();
+            size_t i = 0;
+#ifdef MATRIX_SIMD_SSE
+            const float* m = matrix.elements.data();
+            for (; i < (count & ~size_t(3)); i += 4) {
+                __m128 x, y, z;
+                Blocks::LoadPoints(input[i].components.data(), x, y, z);
+                __m128 w = Blocks::Row(m + 12, x, y, z);
+                Blocks::StorePoints(output[i].components.data(), _mm_div_ps(Blocks::Row(m, x, y, z), w),
+                                    _mm_div_ps(Blocks::Row(m + 4, x, y, z), w), _mm_div_ps(Blocks::Row(m + 8, x, y, z), w));
+            }
+#endif
+            for (; i < count; i++) {
+                Vector4F transformed = Blocks::Transform(input[i], matrix);
+                output[i] = Vector3F(transformed[0] / transformed[3], transformed[1] / transformed[3], transformed[2] / transformed[3]);
+            }
+        }
+
+        // Homogeneous: clip space positions with w kept, for clipping or near plane tests before the divide
+        inline void TransformPointsHomogeneous(std::span<const Vector3F> input, const Matrix4x4F& matrix, std::span<Vector4F> output) {
+            const size_t count = input.size();
+            size_t i = 0;
+#ifdef MATRIX_SIMD_SSE
+            const float* m = matrix.elements.data();
+            for (; i < (count & ~size_t(3)); i += 4) {
+                __m128 x, y, z;
+                Blocks::LoadPoints(input[i].components.data(), x, y, z);
+                __m128 clipX = Blocks::Row(m, x, y, z), clipY = Blocks::Row(m + 4, x, y, z);
+                __m128 clipZ = Blocks::Row(m + 8, x, y, z), clipW = Blocks::Row(m + 12, x, y, z);
+                _MM_TRANSPOSE4_PS(clipX, clipY, clipZ, clipW);
+                _mm_store_ps(output[i].components.data(), clipX);
+                _mm_store_ps(output[i + 1].components.data(), clipY);
+                _mm_store_ps(output[i + 2].components.data(), clipZ);
+                _mm_store_ps(output[i + 3].components.data(), clipW);
+            }
+#endif
+            for (; i < count; i++) output[i] = Blocks::Transform(input[i], matrix);
+        }
+
+        // Normals go through the inverse transpose of the upper 3x3, so they stay perpendicular to surfaces under
+        // non-uniform scale, and come out unit length. Zero normals stay zero
+        inline void TransformNormals(std::span<const Vector3F> input, const Matrix4x4F& matrix, std::span<Vector3F> output) {
+            // inverse transpose = cofactors / determinant
+            auto at = [&](int row, int column) { return matrix.elements[row * 4 + column]; };
+            float normalMatrix[9];
+            for (int row = 0; row < 3; row++) {
+                for (int column = 0; column < 3; column++) {
+                    int r0 = (row + 1) % 3, r1 = (row + 2) % 3, c0 = (column + 1) % 3, c1 = (column + 2) % 3;
+                    normalMatrix[row * 3 + column] = at(r0, c0) * at(r1, c1) - at(r0, c1) * at(r1, c0);
+                }
+            }
+            float determinant = at(0, 0) * normalMatrix[0] + at(0, 1) * normalMatrix[1] + at(0, 2) * normalMatrix[2];
+            if (determinant < 0.0f) {
+                for (float& element : normalMatrix) element = -element;   // only the sign matters, the length is normalized away
+            }
+
+            const size_t count = input.size();
+            size_t i = 0;
+#ifdef MATRIX_SIMD_SSE
+            const __m128 minimumLengthSquared = _mm_set1_ps(1e-20f);
+            for (; i < (count & ~size_t(3)); i += 4) {
+                __m128 x, y, z;
+                Blocks::LoadPoints(input[i].components.data(), x, y, z);
+                __m128 n[3];
+                for (int row = 0; row < 3; row++) {
+                    const float* r = normalMatrix + row * 3;
+                    n[row] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(r[0]), x), _mm_mul_ps(_mm_set1_ps(r[1]), y)), _mm_mul_ps(_mm_set1_ps(r[2]), z));
+                }
+                __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(n[0], n[0]), _mm_mul_ps(n[1], n[1])), _mm_mul_ps(n[2], n[2]));
+                __m128 valid = _mm_cmpgt_ps(lengthSquared, minimumLengthSquared);
+                __m128 length = _mm_sqrt_ps(lengthSquared);
+                Blocks::StorePoints(output[i].components.data(), _mm_and_ps(_mm_div_ps(n[0], length), valid),
+                                    _mm_and_ps(_mm_div_ps(n[1], length), valid), _mm_and_ps(_mm_div_ps(n[2], length), valid));
+            }
+#endif
+            for (; i < count; i++) {
+                const Vector3F& normal = input[i];
+                float n[3];
+                for (int row = 0; row < 3; row++) {
+                    const float* r = normalMatrix + row * 3;
+                    n[row] = r[0] * normal[0] + r[1] * normal[1] + r[2] * normal[2];
+                }
+                float lengthSquared = n[0] * n[0] + n[1] * n[1] + n[2] * n[2];
+                float length = sqrtf(lengthSquared);
+                output[i] = lengthSquared > 1e-20f ? Vector3F(n[0] / length, n[1] / length, n[2] / length) : Vector3F();
+            }
+        }
+
+        // Runs transform(inputChunk, outputChunk) on chunks of chunkSize elements through pool.ParallelFor,
+        // pool being ThreadPool or anything with the same ParallelFor. Small arrays stay on the calling thread:
+        // SplitAcrossThreads(ThreadPool::GetInstance(), points, output, [&](auto in, auto out) { TransformPoints(in, matrix, out); });
+        template<typename Pool, typename Input, typename Output, typename Transform>
+        void SplitAcrossThreads(Pool& pool, const Input& input, Output& output, const Transform& transform, size_t chunkSize = 16384) {
+            std::span inputSpan(input);
+            std::span outputSpan(output);
+            size_t chunkCount = (inputSpan.size() + chunkSize - 1) / chunkSize;
+            if (chunkCount <= 1) {
+                transform(inputSpan, outputSpan);
+                return;
+            }
+            pool.ParallelFor(chunkCount, [&](size_t chunk, size_t) {
+                size_t first = chunk * chunkSize;
+                size_t count = std::min(chunkSize, inputSpan.size() - first);
+                transform(inputSpan.subspan(first, count), outputSpan.subspan(first, count));
+            });
+        }
     }
 }
 
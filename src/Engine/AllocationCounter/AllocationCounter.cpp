@@ -0,0 +1,48 @@
+#include <stdlib.h>
+#include <stddef.h>
+#include <new>
+#include <atomic>
+#include "AllocationCounter.h"
+
+
+#ifndef NDEBUG
+
+namespace {
+    std::atomic<uint64_t> allocationCount{0};
+
+    void* CountedAllocate(size_t bytes, size_t alignment) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        if(bytes == 0) bytes = 1;
+
+        void* memory;
+        if(alignment <= alignof(max_align_t)) memory = malloc(bytes);
+        else memory = aligned_alloc(alignment, (bytes + alignment - 1) & ~(alignment - 1));
+        if(!memory) throw std::bad_alloc();
+        return memory;
+    }
+}
+
+// the nothrow and array forms end up in these in libstdc++ and libc++
+void* operator new(size_t bytes) { return CountedAllocate(bytes, 0); }
+void* operator new[](size_t bytes) { return CountedAllocate(bytes, 0); }
+void* operator new(size_t bytes, std::align_val_t alignment) { return CountedAllocate(bytes, static_cast<size_t>(alignment)); }
+void* operator new[](size_t bytes, std::align_val_t alignment) { return CountedAllocate(bytes, static_cast<size_t>(alignment)); }
+
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete[](void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+void operator delete[](void* memory, size_t) noexcept { free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { free(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { free(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { free(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept { free(memory); }
+
+bool AllocationCounter::IsEnabled() { return true; }
+uint64_t AllocationCounter::GetCount() { return allocationCount.load(std::memory_order_relaxed); }
+
+#else
+
+bool AllocationCounter::IsEnabled() { return false; }
+uint64_t AllocationCounter::GetCount() { return 0; }
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <stdint.h>
+
+
+// Counts global operator new calls from every thread, so a stretch of code can be checked for heap allocations.
+// Only compiled in debug builds (NDEBUG not defined), release builds keep the standard operator new.
+// malloc calls aren't seen, SDL's own allocations don't count
+namespace AllocationCounter {
+    bool IsEnabled();
+    uint64_t GetCount();    // allocations since the program started, always 0 when disabled
+}
+
+#endif
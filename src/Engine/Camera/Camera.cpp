@@ -1,13 +1,15 @@
 #include "Camera.h"
 #include <iostream>
 #include "../../Events/InputEvents.h"
-#include "../../Core/Utilities/OutputFunctions.h"
+#include "../../Core/Utilities/MathFunctions.h"
 
 Camera::Camera(float fov, float aspectRatio, float nearPlane, float farPlane) 
     : fov(fov), aspectRatio(aspectRatio), nearPlane(nearPlane), farPlane(farPlane),
       movementSpeed(5.0f), rotationSpeed(0.02f), mouseLookEnabled(false) {
     
     position = Vector<float, 3>(0.0f, 0.0f, 0.0f);
+    previousPosition = position;
+    currentPosition = position;
     direction = Vector<float, 3>(0.0f, 0.0f, 1.0f);
     up = Vector<float, 3>(0.0f, 1.0f, 0.0f);
     right = Vector<float, 3>(1.0f, 0.0f, 0.0f);
@@ -78,37 +80,50 @@ void Camera::UpdateVectors() {
 
     right = (direction % up).Unit();
     up = (right % direction).Unit();
+    matricesDirty = true;
 }
 
-Matrix<float, 4, 4> Camera::GetViewMatrix() const {
-    Vector<float, 3> target = position + direction;
+void Camera::UpdateMatrices() const {
+    if (!matricesDirty) return;
+    matricesDirty = false;
 
-    
-    return {
+    viewMatrix = {
         right[0],              right[1],                right[2],                negativePosition * right,
         up[0],                 up[1],                   up[2],                   negativePosition * up,
         negativeDirection[0],  negativeDirection[1],    negativeDirection[2],    position * direction,
         0.0f,                  0.0f,                    0.0f,                    1.0f
     };
+    projectionMatrix = MathFunctions::Matrices::CreateProjectionMatrix(fov, aspectRatio, nearPlane, farPlane);
+    viewProjectionMatrix = projectionMatrix * viewMatrix;
+    frustum = Frustum<float>::FromMatrix(viewProjectionMatrix, nearPlane, farPlane);
 }
 
-Matrix<float, 4, 4> Camera::GetProjectionMatrix() const {
-    float fovRad = 1.0f / tanf(fov * 0.5f * 3.14159f / 180.0f);
-    float aspect = aspectRatio;
+const Matrix<float, 4, 4>& Camera::GetViewMatrix() const {
+    UpdateMatrices();
+    return viewMatrix;
+}
 
-    float q = 1.0f / (farPlane - nearPlane);
-    
-    return {
-        aspect * fovRad,   0.0f,          0.0f,              0.0f,
-        0.0f,              fovRad,        0.0f,              0.0f,
-        0.0f,              0.0f,          farPlane * q,     -q * farPlane * nearPlane,
-        0.0f,              0.0f,          1.0f,              0.0f
-    };
+const Matrix<float, 4, 4>& Camera::GetProjectionMatrix() const {
+    UpdateMatrices();
+    return projectionMatrix;
+}
+
+const Matrix<float, 4, 4>& Camera::GetViewProjectionMatrix() const {
+    UpdateMatrices();
+    return viewProjectionMatrix;
+}
+
+const Frustum<float>& Camera::GetFrustum() const {
+    UpdateMatrices();
+    return frustum;
 }
 
 void Camera::SetPosition(const Vector<float, 3> &newPosition) {
     position = newPosition;
+    previousPosition = newPosition;
+    currentPosition = newPosition;
     negativePosition = -position;
+    matricesDirty = true;
 }
 
 void Camera::SetDirection(const Vector<float, 3> &newDirection) {
@@ -118,7 +133,10 @@ void Camera::SetDirection(const Vector<float, 3> &newDirection) {
 
 void Camera::Move(const Vector<float, 3> &offset) {
     position += offset;
+    previousPosition += offset;
+    currentPosition += offset;
     negativePosition = -position;
+    matricesDirty = true;
 }
 
 void Camera::Rotate(float yaw, float pitch) {
@@ -132,7 +150,9 @@ void Camera::Rotate(float yaw, float pitch) {
     UpdateVectors();
 }
 
-void Camera::Update(float deltaTime) {
+void Camera::Step(float deltaTime) {
+    previousPosition = currentPosition;
+
     Vector<float, 3> moveDirection(0.0f, 0.0f, 0.0f);
     if (moveForward) moveDirection += direction;
     if (moveBackward) moveDirection -= direction;
@@ -141,10 +161,19 @@ void Camera::Update(float deltaTime) {
     if (moveUp) moveDirection += up;
     if (moveDown) moveDirection -= up;
 
-    std::cout<<moveDirection<<std::endl;
-
     if (moveDirection.SquaredComponentSum() > 0) {
         moveDirection.Normalize();
-        Move(moveDirection * movementSpeed * deltaTime);
+        currentPosition += moveDirection * movementSpeed * deltaTime;
     }
-}
\ No newline at end of file
+}
+
+void Camera::Interpolate(float alpha) {
+    position = previousPosition + (currentPosition - previousPosition) * alpha;
+    negativePosition = -position;
+    matricesDirty = true;
+}
+
+void Camera::Update(float deltaTime) {
+    Step(deltaTime);
+    Interpolate(1.0f);
+}
@@ -4,6 +4,7 @@
 #include "../../Core/Math/Vector.h"
 #include "../../Core/Math/Matrix.h"
 #include "../../Core/Math/Quaternion.h"
+#include "../../Core/Geometry/Frustum.h"
 #include "../EventController/EventController.h"
 #include "../../Events/InputEvents.h"
 
@@ -20,12 +21,19 @@ private:
     
 
     Vector<float, 3> position, direction, up, right, negativeDirection, negativePosition;
+    // the last two fixed steps' positions, position is drawn somewhere between them
+    Vector<float, 3> previousPosition, currentPosition;
     
     float fov;
     float aspectRatio;
     float nearPlane;
     float farPlane;
     
+    // Built on first use after the camera moved or turned, the getters below are called several times a frame
+    mutable Matrix<float, 4, 4> viewMatrix, projectionMatrix, viewProjectionMatrix;
+    mutable Frustum<float> frustum;
+    mutable bool matricesDirty = true;
+
     float movementSpeed;
     float rotationSpeed;
     
@@ -43,6 +51,7 @@ private:
     void HandleMouseButton(const MouseButtonEvent& event);
     
     void UpdateVectors();
+    void UpdateMatrices() const;
 
 public:
     Camera(float fov, float aspectRatio, float nearPlane, float farPlane);
@@ -51,8 +60,11 @@ public:
     void SubscribeToEvents(EventController& eventController);
     void UnsubscribeFromEvents(EventController& eventController);
     
-    Matrix<float, 4, 4> GetViewMatrix() const;
-    Matrix<float, 4, 4> GetProjectionMatrix() const;
+    const Matrix<float, 4, 4>& GetViewMatrix() const;
+    const Matrix<float, 4, 4>& GetProjectionMatrix() const;
+    const Matrix<float, 4, 4>& GetViewProjectionMatrix() const;
+    // world space planes of what the camera sees
+    const Frustum<float>& GetFrustum() const;
 
     void SetPosition(const Vector<float, 3> &newPosition);
     void SetDirection(const Vector<float, 3> &newDirection);
@@ -62,7 +74,13 @@ public:
     
     Vector<float, 3> GetPosition() const { return position; };
     Vector<float, 3> GetDirection() const { return direction; };
+    float GetNearPlane() const { return nearPlane; };
+    float GetFarPlane() const { return farPlane; };
     
+    // Step moves the camera by one step's worth of the held keys, Interpolate places it between the last two
+    // steps (0 is the previous one, 1 the latest), Update does both for a frame that is one step long
+    void Step(float deltaTime);
+    void Interpolate(float alpha);
     void Update(float deltaTime);
 };
 
@@ -1,19 +1,31 @@
-#include <SDL2/SDL.h>
+#include <chrono>
 #include <stdint.h>
 #include "Clock.h"
 
-Clock::Clock() : lastUpdateTime(SDL_GetTicks64()), deltaTime(0.0f) {}
+namespace {
+    const std::chrono::steady_clock::time_point clockStart = std::chrono::steady_clock::now();
+}
+
+Clock::Clock() : lastUpdateTime(Now()), deltaNanoseconds(0) {}
+
+uint64_t Clock::Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - clockStart).count();
+}
 
 void Clock::Update() {
-    uint64_t currentTime = SDL_GetTicks64();
-    deltaTime = (currentTime - lastUpdateTime) / 1000.0f;
+    uint64_t currentTime = Now();
+    deltaNanoseconds = currentTime - lastUpdateTime;
     lastUpdateTime = currentTime;
 }
 
 float Clock::GetDeltaTime() const {
-    return deltaTime;
+    return deltaNanoseconds * 1e-9f;
+}
+
+uint64_t Clock::GetDeltaNanoseconds() const {
+    return deltaNanoseconds;
 }
 
 uint64_t Clock::GetCurrentTime() const {
     return lastUpdateTime;
-}
\ No newline at end of file
+}
@@ -1,9 +1,9 @@
 #ifndef CLOCK_H
 #define CLOCK_H
 
-#include <SDL2/SDL.h>
 #include <stdint.h>
 
+// Frame timing off the monotonic steady clock, every time in nanoseconds since the clock was created
 class Clock {
     public:
         static Clock& GetInstance() {
@@ -11,14 +11,19 @@ class Clock {
             return instance;
         }
 
+        // once at the start of every frame
         void Update();
-        float GetDeltaTime() const;
-        uint64_t GetCurrentTime() const;
+        float GetDeltaTime() const;             // seconds between the last two Update calls
+        uint64_t GetDeltaNanoseconds() const;
+        uint64_t GetCurrentTime() const;        // as of the last Update
+
+        // read now, not as of the last Update
+        static uint64_t Now();
 
     private:
         Clock();
         uint64_t lastUpdateTime;
-        float deltaTime;
+        uint64_t deltaNanoseconds;
 };
 
-#endif
\ No newline at end of file
+#endif
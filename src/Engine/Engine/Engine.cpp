@@ -4,36 +4,251 @@
 #include <math.h>
 #include <algorithm>
 #include <string>
+#include <assert.h>
 
 #include "../../Core/Math/Vector.h"
 #include "../../Core/Math/Matrix.h"
+#include "../../Core/Math/MatrixSIMDCheck.h"
 #include "../Clock/Clock.h"
+#include "../FrameArena/FrameArena.h"
+#include "../AllocationCounter/AllocationCounter.h"
+#include "../Profiler/Profiler.h"
+#include "../../Graphics/Rasterizer/TriangleKernels.h"
 #include "Engine.h"
 
 
 bool Engine::Initialize(){
+
+#ifndef NDEBUG
+    // the SSE matrix math has to match the generic loops bit for bit
+    size_t simdMismatches = MatrixSIMDCheck::CountMismatches(simdCheckSamples);
+    if(simdMismatches != 0) std::cout<<"MatrixSIMD: "<<simdMismatches<<" results differ from the generic loops"<<std::endl;
+    assert(simdMismatches == 0);
+#endif
     
     windows = std::vector<Window>(2, Window(800, 600, "3d engine"));
 
     for(int i=0; i<windows.size(); i++){
         if (!windows[i].Init()) return false;
+        windows[i].renderer3D->SetClipPlanes(camera.GetNearPlane(), camera.GetFarPlane());
+    }
+
+    // the first window records the frame's draw list, see RenderWindows
+    for(size_t i = 0; i < windows.size(); i++){
+        windowWorkers.push_back(std::make_unique<Worker>());
+        windowJobs.push_back([this, i](){
+            Renderer3D* renderer3D = windows[i].renderer3D;
+            if(i != 0) renderer3D->Clear();
+            renderer3D->Rasterize(drawList);
+        });
     }
 
     running = true;
+    frameLimiter.SetTargetFps(frameRateLimits[0]);
 
 
     camera.SubscribeToEvents(eventController);
 
+    eventController.Subscribe<KeyboardEvent>([this](const KeyboardEvent& event) {
+        if(!event.pressed) return;
+        if(event.key == SDLK_F1) ToggleRendererBackend();
+        if(event.key == SDLK_F2) ToggleDepthMode();
+        if(event.key == SDLK_F3) PrintRenderStats();
+        if(event.key == SDLK_F4) ToggleTiledRasterization();
+        if(event.key == SDLK_F5) CycleFillKernel();
+        if(event.key == SDLK_F6) ToggleBatchedGeometry();
+        if(event.key == SDLK_F7) ToggleOcclusionCulling();
+        if(event.key == SDLK_F8) CycleFrameRateLimit();
+        if(event.key == SDLK_F9) ToggleFixedTimestep();
+        if(event.key == SDLK_F10) WriteTrace();
+    });
+
     return true;
 }
 
 
+// F1 flips every window between the SDL draw call backend and the CPU framebuffer one, to compare frame times
+void Engine::ToggleRendererBackend(){
+    for(int i=0; i<windows.size(); i++){
+        Renderer2D* renderer2D = windows[i].renderer2D;
+        bool usingFramebuffer = renderer2D->GetBackend() == Renderer2D::Backend::Framebuffer;
+        renderer2D->SetBackend(usingFramebuffer ? Renderer2D::Backend::SDL : Renderer2D::Backend::Framebuffer);
+    }
+    std::cout<<"Renderer2D backend: "<<(windows[0].renderer2D->GetBackend() == Renderer2D::Backend::Framebuffer ? "framebuffer" : "SDL")<<std::endl;
+}
+
+// F2 switches between the painter's sort and the per-pixel depth buffer
+void Engine::ToggleDepthMode(){
+    for(int i=0; i<windows.size(); i++){
+        Renderer3D* renderer3D = windows[i].renderer3D;
+        bool usingDepthBuffer = renderer3D->GetDepthMode() == Renderer3D::DepthMode::DepthBuffer;
+        renderer3D->SetDepthMode(usingDepthBuffer ? Renderer3D::DepthMode::PainterSort : Renderer3D::DepthMode::DepthBuffer);
+    }
+    std::cout<<"Depth mode: "<<(windows[0].renderer3D->GetDepthMode() == Renderer3D::DepthMode::DepthBuffer ? "depth buffer" : "painter's sort")<<std::endl;
+}
+
+// F4 switches between the tile-binned multithreaded rasterizer and the single threaded one
+void Engine::ToggleTiledRasterization(){
+    for(int i=0; i<windows.size(); i++){
+        Renderer3D* renderer3D = windows[i].renderer3D;
+        renderer3D->SetTiledRasterization(!renderer3D->GetTiledRasterization());
+    }
+    std::cout<<"Tiled rasterization: "<<(windows[0].renderer3D->GetTiledRasterization() ? "on" : "off")<<std::endl;
+}
+
+// F5 steps the triangle fill kernel down AVX2 -> SSE2 -> scalar and back to the best the CPU has
+void Engine::CycleFillKernel(){
+    using TriangleKernels::InstructionSet;
+    InstructionSet current = TriangleKernels::GetInstructionSet();
+    TriangleKernels::SetInstructionSet(current == InstructionSet::Scalar ? InstructionSet::AVX2 : static_cast<InstructionSet>(static_cast<int>(current) - 1));
+    std::cout<<"Fill kernel: "<<TriangleKernels::GetInstructionSetName(TriangleKernels::GetInstructionSet())<<std::endl;
+}
+
+// F6 switches the SDL backend between one SDL_RenderGeometry call per frame and per-span lines
+void Engine::ToggleBatchedGeometry(){
+    for(int i=0; i<windows.size(); i++){
+        Renderer3D* renderer3D = windows[i].renderer3D;
+        renderer3D->SetBatchedGeometry(!renderer3D->GetBatchedGeometry());
+    }
+    std::cout<<"Batched SDL geometry: "<<(windows[0].renderer3D->GetBatchedGeometry() ? "on" : "off")<<std::endl;
+}
+
+// F7 switches hierarchical-Z occlusion culling, it only runs in depth buffer mode
+void Engine::ToggleOcclusionCulling(){
+    for(int i=0; i<windows.size(); i++){
+        Renderer3D* renderer3D = windows[i].renderer3D;
+        renderer3D->SetOcclusionCulling(!renderer3D->GetOcclusionCulling());
+    }
+    std::cout<<"Occlusion culling: "<<(windows[0].renderer3D->GetOcclusionCulling() ? "on" : "off")<<std::endl;
+}
+
+// F8 steps the frame rate limit through frameRateLimits, 0 is unlimited for benchmarking
+void Engine::CycleFrameRateLimit(){
+    frameRateLimitIndex = (frameRateLimitIndex + 1) % (sizeof(frameRateLimits) / sizeof(frameRateLimits[0]));
+    frameLimiter.SetTargetFps(frameRateLimits[frameRateLimitIndex]);
+    if(frameLimiter.GetTargetFps() > 0.0f) std::cout<<"Frame rate limit: "<<frameLimiter.GetTargetFps()<<" fps"<<std::endl;
+    else std::cout<<"Frame rate limit: unlimited"<<std::endl;
+}
+
+// F9 switches between one simulation step per frame and fixed steps with interpolated rendering
+void Engine::ToggleFixedTimestep(){
+    fixedTimestep = !fixedTimestep;
+    stepAccumulator = 0.0f;
+    std::cout<<"Fixed timestep: "<<(fixedTimestep ? "on" : "off")<<std::endl;
+}
+
+// F10 saves the profiler's recent events, only with ENABLE_PROFILER defined
+void Engine::WriteTrace(){
+    if(!Profiler::IsEnabled()){
+        std::cout<<"Profiler not compiled in, build with -DENABLE_PROFILER"<<std::endl;
+        return;
+    }
+    if(Profiler::WriteChromeTrace(tracePath)) std::cout<<"Trace written to "<<tracePath<<", open it in ui.perfetto.dev"<<std::endl;
+    else std::cout<<"Couldn't write "<<tracePath<<std::endl;
+}
+
+// F3 dumps the last frame's counters of the first window
+void Engine::PrintRenderStats(){
+    const Renderer3D::RenderStats& stats = windows[0].renderer3D->GetStats();
+    std::cout<<"triangles: "<<stats.trianglesSubmitted<<" submitted, "<<stats.trianglesFrustumCulled<<" in "
+             <<stats.clustersFrustumCulled<<" clusters outside frustum, "<<stats.trianglesOutsideFrustum<<" outside frustum, "
+             <<stats.trianglesClipped<<" clipped, "<<stats.trianglesCulled<<" culled, "
+             <<stats.trianglesRasterized<<" rasterized"<<std::endl;
+    std::cout<<"vertices: "<<stats.verticesTransformed<<" transformed"<<std::endl;
+    std::cout<<"levels of detail: "<<stats.trianglesSimplified<<" triangles simplified away"<<std::endl;
+    std::cout<<"occlusion: "<<stats.clustersOccluded<<" of "<<stats.clustersTested<<" tested clusters hidden, "
+             <<stats.trianglesOccluded<<" triangles skipped"<<std::endl;
+    std::cout<<"frame: "<<Clock::GetInstance().GetDeltaNanoseconds() / 1e6<<" ms"<<std::endl;
+    std::cout<<"pixels: "<<stats.pixelsShaded<<" shaded, "<<stats.pixelsRejected<<" depth rejected, overdraw "
+             <<stats.overdraw<<std::endl;
+}
+
+// Debug builds only: once nothing changed for a few frames, rendering must not touch the heap.
+// Per-frame scratch belongs in the FrameArena, buffers that outlive the frame have to be reserved up front
+void Engine::CheckRenderAllocations(uint64_t allocations){
+    if(!AllocationCounter::IsEnabled()) return;
+    if(++steadyFrames <= allocationCheckWarmupFrames || allocations == 0) return;
+
+    std::cout<<"Steady state frame made "<<allocations<<" heap allocations while rendering"<<std::endl;
+    assert(allocations == 0);
+}
+
+
+// every mesh with an instance in view once, with all of its instances in view
+void Engine::DrawScene(Renderer3D& renderer3D, const Matrix<float, 4, 4>& viewProjMatrix){
+    PROFILE_FUNCTION();
+    const std::vector<Scene::MeshInstance>& instances = scene.GetInstances();
+    const SceneGraph& sceneGraph = scene.GetSceneGraph();
+
+    for(size_t first = 0; first < visibleInstances.size();){
+        const MeshRegistry::MeshHandle meshHandle = instances[visibleInstances[first]].mesh;
+        const MeshRegistry::Entry& mesh = scene.GetMeshRegistry().Get(meshHandle);
+
+        levelDraws.clear();
+        for(const MeshRegistry::Level& level : mesh.levels){
+            levelDraws.push_back({ &level.mesh, &level.clusters, &level.clusterTree });
+        }
+
+        instanceDraws.clear();
+        size_t last = first;
+        for(; last < visibleInstances.size() && instances[visibleInstances[last]].mesh == meshHandle; last++){
+            const Scene::MeshInstance& instance = instances[visibleInstances[last]];
+            instanceDraws.push_back({ sceneGraph.GetWorldMatrix(instance.node), scene.GetMaterial(instance), instance.node });
+        }
+
+        renderer3D.Render(levelDraws, instanceDraws, viewProjMatrix, camera.GetPosition());
+        first = last;
+    }
+}
+
+
+// Every window shows the camera's view, so the first window's renderer transforms, culls and sorts it once
+// into drawList and each window only rasterizes that. Windows rendering into their framebuffer do it on their
+// own worker, SDL draw calls and presenting have to stay on this thread. Only the untiled work overlaps:
+// tiled rasterization goes through the ThreadPool, which runs one window's tiles at a time on all its threads
+void Engine::RenderWindows(const Matrix<float, 4, 4>& viewProjMatrix){
+    PROFILE_FUNCTION();
+    Renderer3D& recorder = *windows[0].renderer3D;
+    recorder.Clear();
+    recorder.BeginRecording(drawList);
+    DrawScene(recorder, viewProjMatrix);
+    recorder.EndRecording();
+
+    for(size_t i = 0; i < windows.size(); i++){
+        if(windows[i].renderer2D->GetBackend() == Renderer2D::Backend::Framebuffer) windowWorkers[i]->Run(windowJobs[i]);
+        else windowJobs[i]();
+    }
+    for(size_t i = 0; i < windows.size(); i++){
+        windowWorkers[i]->Wait();
+        windows[i].renderer3D->Present();
+    }
+}
+
+
+// With the fixed timestep the simulation advances in steps of exactly fixedStep, as many as the frame's time
+// covers, and the scene is drawn between the last two by whatever time is left over. Otherwise it takes one
+// step of the frame's length
 void Engine::Update(){
+    PROFILE_FUNCTION();
     Clock &clock = Clock::GetInstance();
     clock.Update();
     inputHandler.Update();
-    scene.Update();
-    camera.Update(clock.GetDeltaTime());
+
+    if(!fixedTimestep){
+        scene.Update(clock.GetDeltaTime());
+        camera.Update(clock.GetDeltaTime());
+        return;
+    }
+
+    // after a long stall the simulation drops time rather than trying to catch up all at once
+    stepAccumulator += std::min(clock.GetDeltaTime(), maxStepBacklog);
+    while(stepAccumulator >= fixedStep){
+        scene.Step(fixedStep);
+        camera.Step(fixedStep);
+        stepAccumulator -= fixedStep;
+    }
+    scene.Interpolate(stepAccumulator / fixedStep);
+    camera.Interpolate(stepAccumulator / fixedStep);
 }
 
 
@@ -44,12 +259,15 @@ void Engine::Run(){
     float t = 0.0f;
     running = true;
     SDL_Event event;
+    Profiler::SetThreadName("Main");
     
-    scene.LoadModel("../assets/models/rizzard.obj");
-    scene.Update();
+    scene.LoadModel("../assets/models/rizzard.obj", true);
+    scene.Update(0.0f);
+    Clock::GetInstance().Update();
 
 
     while(running){
+        PROFILE_SCOPE("Frame");
          while(SDL_PollEvent(&event) != 0){
             if(event.type == SDL_QUIT){
                 running = false;
@@ -60,21 +278,22 @@ void Engine::Run(){
             }
 
             inputHandler.AddEventToProcessingQueue(event);
+            steadyFrames = 0;
         }
 
         Update();
         
-        Matrix<float, 4, 4> viewProjMatrix = camera.GetProjectionMatrix() * camera.GetViewMatrix();
+        const Matrix<float, 4, 4>& viewProjMatrix = camera.GetViewProjectionMatrix();
+        visibleInstances.clear();
+        scene.CollectVisibleInstances(camera.GetFrustum(), visibleInstances);
 
-        auto triangles = scene.GetTriangles();
 
-        for(int i=0; i<2; i++) {
-            windows[i].renderer3D->Clear();
-            windows[i].renderer3D->Render(triangles, scene.GetFinalTransformationMatrix(), viewProjMatrix,  camera.GetPosition());
-            windows[i].renderer3D->Present();
-        }
+        uint64_t allocationsBefore = AllocationCounter::GetCount();
+        RenderWindows(viewProjMatrix);
+        CheckRenderAllocations(AllocationCounter::GetCount() - allocationsBefore);
+        FrameArena::GetInstance().Reset();
+
+        frameLimiter.Wait();
 
-        SDL_Delay(100);
-        
     }
 }
\ No newline at end of file
@@ -1,9 +1,13 @@
 #ifndef ENGINE_H
 #define ENGINE_H
 
+#include <vector>
+#include <memory>
 #include "../Window/Window.h"
 #include "../Scene/Scene.h"
 #include "../Camera/Camera.h"
+#include "../Worker/Worker.h"
+#include "../FrameLimiter/FrameLimiter.h"
 #include "../../Graphics/Renderer3D/Renderer3D.h"
 
 #include "../../Events/InputEvents.h"
@@ -18,6 +22,50 @@ class Engine {
         EventController eventController;
         InputHandler inputHandler;
         Camera camera;
+
+        // F8 cycles through these, 0 is unlimited
+        static constexpr float frameRateLimits[] = { 60.0f, 144.0f, 0.0f };
+        size_t frameRateLimitIndex = 0;
+        FrameLimiter frameLimiter;
+
+        static constexpr float fixedStep = 1.0f / 60.0f;
+        static constexpr float maxStepBacklog = 0.25f;
+        bool fixedTimestep = false;
+        float stepAccumulator = 0.0f;   // frame time not yet simulated, less than fixedStep after Update
+
+        static constexpr const char* tracePath = "trace.json";
+
+        // random inputs the debug build's startup check of the SSE matrix math runs
+        static constexpr int simdCheckSamples = 10000;
+
+        // frames rendered since the last event, only those after the warmup count as steady state
+        static constexpr int allocationCheckWarmupFrames = 10;
+        int steadyFrames = 0;
+
+        // the instances in the camera's frustum and one mesh's worth of them at a time,
+        // kept so steady frames don't allocate
+        std::vector<uint32_t> visibleInstances;
+        std::vector<Renderer3D::Instance> instanceDraws;
+        std::vector<Renderer3D::LevelOfDetail> levelDraws;
+
+        // the view's transformed and sorted triangles, recorded once per frame and rasterized by every window
+        Renderer3D::DrawList drawList;
+        std::vector<std::unique_ptr<Worker>> windowWorkers;
+        std::vector<Worker::Job> windowJobs;
+
+        void ToggleRendererBackend();
+        void ToggleDepthMode();
+        void PrintRenderStats();
+        void ToggleTiledRasterization();
+        void CycleFillKernel();
+        void ToggleBatchedGeometry();
+        void ToggleOcclusionCulling();
+        void CycleFrameRateLimit();
+        void ToggleFixedTimestep();
+        void WriteTrace();
+        void CheckRenderAllocations(uint64_t allocations);
+        void DrawScene(Renderer3D& renderer3D, const Matrix<float, 4, 4>& viewProjMatrix);
+        void RenderWindows(const Matrix<float, 4, 4>& viewProjMatrix);
         
     public:
         bool Initialize();
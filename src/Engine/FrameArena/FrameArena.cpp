@@ -0,0 +1,67 @@
+#include <algorithm>
+#include <new>
+#include <stdint.h>
+#include "FrameArena.h"
+
+
+FrameArena::FrameArena() {
+    AddBlock(initialCapacity);
+}
+
+FrameArena::~FrameArena() {
+    FreeBlocks();
+}
+
+
+void* FrameArena::Allocate(size_t bytes, size_t alignment) {
+    while(true){
+        Block& block = blocks[currentBlock];
+        uintptr_t address = reinterpret_cast<uintptr_t>(block.memory) + offset;
+        size_t padding = (alignment - address % alignment) % alignment;
+
+        if(offset + padding + bytes <= block.size){
+            offset += padding + bytes;
+            peakUsage = std::max(peakUsage, usedInEarlierBlocks + offset);
+            return block.memory + offset - bytes;
+        }
+
+        // doubles the capacity, the rest of the full block stays unused until Reset()
+        usedInEarlierBlocks += block.size;
+        offset = 0;
+        AddBlock(std::max(capacity, bytes + alignment));
+        currentBlock = blocks.size() - 1;
+    }
+}
+
+void FrameArena::Deallocate(void* memory, size_t bytes) {
+    char* end = static_cast<char*>(memory) + bytes;
+    Block& block = blocks[currentBlock];
+    if(end == block.memory + offset) offset -= bytes;
+}
+
+void FrameArena::Reset() {
+    if(blocks.size() > 1){
+        // the frame overflowed, next time all of it fits in one block
+        size_t mergedCapacity = capacity;
+        FreeBlocks();
+        AddBlock(mergedCapacity);
+    }
+    currentBlock = 0;
+    offset = 0;
+    usedInEarlierBlocks = 0;
+}
+
+
+// through operator new so the allocation counter sees the arena growing
+void FrameArena::AddBlock(size_t size) {
+    size = (size + blockAlignment - 1) & ~(blockAlignment - 1);
+    char* memory = static_cast<char*>(::operator new(size, std::align_val_t(blockAlignment)));
+    blocks.push_back({ memory, size });
+    capacity += size;
+}
+
+void FrameArena::FreeBlocks() {
+    for(const Block& block : blocks) ::operator delete(block.memory, std::align_val_t(blockAlignment));
+    blocks.clear();
+    capacity = 0;
+}
@@ -0,0 +1,85 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <stddef.h>
+#include <vector>
+
+
+// Bump allocator for scratch data that only lives for one frame, Reset() at the end of every frame frees
+// all of it at once. Allocating is a pointer bump, freeing is a no-op unless it's the latest allocation.
+// When a frame needs more than the arena holds a new block is chained on, and the next Reset() merges
+// everything into one block, so after the first few frames the arena never touches the heap again.
+// Every thread gets its own, created the first time it asks, and resets it itself once its frame's work is done
+class FrameArena {
+    public:
+        static FrameArena& GetInstance() {
+            thread_local FrameArena instance;
+            return instance;
+        }
+
+        void* Allocate(size_t bytes, size_t alignment);
+        // only gives the memory back when nothing was allocated after it, e.g. a vector growing in place of its old buffer
+        void Deallocate(void* memory, size_t bytes);
+
+        // everything allocated so far becomes invalid
+        void Reset();
+
+        size_t GetCapacity() const { return capacity; }
+        size_t GetPeakUsage() const { return peakUsage; }   // most bytes a single frame used
+
+    private:
+        FrameArena();
+        ~FrameArena();
+        FrameArena(const FrameArena&) = delete;
+        FrameArena& operator=(const FrameArena&) = delete;
+
+        static constexpr size_t initialCapacity = 1 << 20;
+        static constexpr size_t blockAlignment = 64;
+
+        struct Block {
+            char* memory;
+            size_t size;
+        };
+
+        std::vector<Block> blocks;
+        size_t currentBlock = 0;
+        size_t offset = 0;              // into the current block
+        size_t usedInEarlierBlocks = 0;
+        size_t capacity = 0;
+        size_t peakUsage = 0;
+
+        void AddBlock(size_t size);
+        void FreeBlocks();
+};
+
+
+// std::allocator replacement backed by the frame arena, e.g. |FrameVector<Triangle3D>| for per-frame scratch.
+// Containers using it must not outlive the frame
+template <typename Type>
+struct ArenaAllocator {
+    using value_type = Type;
+
+    ArenaAllocator() noexcept {}
+
+    template <typename OtherType>
+    ArenaAllocator(const ArenaAllocator<OtherType>&) noexcept {}
+
+    Type* allocate(size_t count) {
+        return static_cast<Type*>(FrameArena::GetInstance().Allocate(count * sizeof(Type), alignof(Type)));
+    }
+
+    void deallocate(Type* memory, size_t count) noexcept {
+        FrameArena::GetInstance().Deallocate(memory, count * sizeof(Type));
+    }
+
+    template <typename OtherType>
+    bool operator==(const ArenaAllocator<OtherType>&) const noexcept { return true; }
+
+    template <typename OtherType>
+    bool operator!=(const ArenaAllocator<OtherType>&) const noexcept { return false; }
+};
+
+template <typename Type>
+using FrameVector = std::vector<Type, ArenaAllocator<Type>>;
+
+#endif
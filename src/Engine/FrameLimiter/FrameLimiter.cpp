@@ -0,0 +1,27 @@
+#include <thread>
+#include <chrono>
+#include "FrameLimiter.h"
+#include "../Clock/Clock.h"
+#include "../Profiler/Profiler.h"
+
+
+void FrameLimiter::SetTargetFps(float fps) {
+    targetFps = fps > 0.0f ? fps : 0.0f;
+    frameDuration = targetFps > 0.0f ? static_cast<uint64_t>(1e9 / targetFps) : 0;
+    nextDeadline = 0;
+}
+
+void FrameLimiter::Wait() {
+    PROFILE_FUNCTION();
+    if (frameDuration == 0) return;
+
+    uint64_t now = Clock::Now();
+    // the first frame, or so far behind that catching up would mean a burst of unpaced frames
+    if (nextDeadline == 0 || now > nextDeadline + frameDuration) nextDeadline = now;
+    else nextDeadline += frameDuration;
+
+    if (nextDeadline > now + spinMargin) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(nextDeadline - now - spinMargin));
+    }
+    while (Clock::Now() < nextDeadline) std::this_thread::yield();
+}
@@ -0,0 +1,26 @@
+#ifndef FRAME_LIMITER_H
+#define FRAME_LIMITER_H
+
+#include <stdint.h>
+
+
+// Holds the frame rate to a target. Frames are due at fixed intervals, so one slow frame doesn't push all
+// later ones back. Waiting sleeps until spinMargin before the deadline, sleeps overshoot by about the
+// scheduler's time slice, and spins the rest. A target of 0 is unlimited, for benchmarking
+class FrameLimiter {
+    public:
+        void SetTargetFps(float fps);
+        float GetTargetFps() const { return targetFps; }
+
+        // call once per frame, returns once the frame's time is up
+        void Wait();
+
+    private:
+        static constexpr uint64_t spinMargin = 2'000'000;   // nanoseconds
+
+        float targetFps = 0.0f;
+        uint64_t frameDuration = 0;
+        uint64_t nextDeadline = 0;
+};
+
+#endif
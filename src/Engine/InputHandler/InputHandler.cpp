@@ -1,5 +1,6 @@
 #include "InputHandler.h"
 #include "../../Events/InputEvents.h"
+#include "../Profiler/Profiler.h"
 
 
 void InputHandler::AddEventToProcessingQueue(const SDL_Event &event) {
@@ -8,6 +9,7 @@ void InputHandler::AddEventToProcessingQueue(const SDL_Event &event) {
 
 
 void InputHandler::Update(){
+    PROFILE_FUNCTION();
     for(int i=0; i<SDL_NUM_SCANCODES; i++){
         lastFrameKeyStates[i] = keyStates[i];
     }
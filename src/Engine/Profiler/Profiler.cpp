@@ -0,0 +1,121 @@
+#include "Profiler.h"
+
+#ifdef ENABLE_PROFILER
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <fstream>
+#include <iomanip>
+#include "../Clock/Clock.h"
+
+
+namespace {
+    struct Event {
+        const char* name;
+        uint64_t start, end;    // Clock::Now nanoseconds
+    };
+
+    // Written by its own thread only: the event first, then the count with release, so a reader that
+    // acquires the count sees every event before it
+    struct ThreadBuffer {
+        static constexpr uint64_t capacity = 1 << 16;   // a power of two, indices wrap with a mask
+
+        std::unique_ptr<Event[]> events = std::make_unique<Event[]>(capacity);
+        std::atomic<uint64_t> written{0};
+        uint32_t threadIndex = 0;
+        std::string name;       // under registryMutex
+    };
+
+    std::atomic<bool> capturing{true};
+
+    // buffers live until the program ends, so a finished thread's events can still be written out
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> threadBuffers;
+    thread_local ThreadBuffer* currentBuffer = nullptr;
+
+    // registering is the only lock, once per thread
+    ThreadBuffer& GetThreadBuffer() {
+        if (currentBuffer) return *currentBuffer;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        threadBuffers.push_back(std::make_unique<ThreadBuffer>());
+        currentBuffer = threadBuffers.back().get();
+        currentBuffer->threadIndex = static_cast<uint32_t>(threadBuffers.size() - 1);
+        currentBuffer->name = "Thread " + std::to_string(currentBuffer->threadIndex);
+        return *currentBuffer;
+    }
+
+    // names are identifiers and function names, only quotes and backslashes would break the JSON
+    void WriteEscaped(std::ofstream& file, const char* text) {
+        for (; *text; text++) {
+            if (*text == '"' || *text == '\\') file << '\\';
+            file << *text;
+        }
+    }
+}
+
+
+bool Profiler::IsEnabled() { return true; }
+
+uint64_t Profiler::Now() { return Clock::Now(); }
+
+bool Profiler::IsCapturingFast() { return capturing.load(std::memory_order_relaxed); }
+
+void Profiler::Record(const char* name, uint64_t start, uint64_t end) {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    uint64_t index = buffer.written.load(std::memory_order_relaxed);
+    buffer.events[index & (ThreadBuffer::capacity - 1)] = { name, start, end };
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::SetThreadName(const char* name) {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer.name = name;
+}
+
+void Profiler::SetCapturing(bool enabled) { capturing.store(enabled, std::memory_order_relaxed); }
+
+bool Profiler::IsCapturing() { return capturing.load(std::memory_order_relaxed); }
+
+// Complete ("X") events with microsecond timestamps, plus a thread_name metadata event per thread
+bool Profiler::WriteChromeTrace(const std::string& path) {
+    std::ofstream file(path);
+    if (!file) return false;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    bool first = true;
+    for (const std::unique_ptr<ThreadBuffer>& buffer : threadBuffers) {
+        file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadIndex
+             << ",\"args\":{\"name\":\"";
+        WriteEscaped(file, buffer->name.c_str());
+        file << "\"}}";
+        first = false;
+
+        uint64_t written = buffer->written.load(std::memory_order_acquire);
+        uint64_t oldest = written > ThreadBuffer::capacity ? written - ThreadBuffer::capacity : 0;
+        for (uint64_t i = oldest; i < written; i++) {
+            const Event& event = buffer->events[i & (ThreadBuffer::capacity - 1)];
+            file << ",\n{\"name\":\"";
+            WriteEscaped(file, event.name);
+            file << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadIndex << ",\"ts\":" << event.start / 1000.0
+                 << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+        }
+    }
+    file << "\n]}\n";
+    return static_cast<bool>(file);
+}
+
+#else
+
+bool Profiler::IsEnabled() { return false; }
+void Profiler::SetThreadName(const char*) {}
+void Profiler::SetCapturing(bool) {}
+bool Profiler::IsCapturing() { return false; }
+bool Profiler::WriteChromeTrace(const std::string&) { return false; }
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include <string>
+
+
+// Scoped CPU timings for finding where a frame's time goes. PROFILE_SCOPE("name") times the rest of the
+// enclosing block, PROFILE_FUNCTION() the enclosing function. Each thread records into its own ring buffer
+// with no locks, the oldest events get overwritten, and WriteChromeTrace saves what the buffers hold as Chrome
+// trace JSON for chrome://tracing or ui.perfetto.dev.
+// Only compiled in with ENABLE_PROFILER defined. Without it the macros expand to nothing and the functions
+// below do nothing, so instrumented code costs exactly what it did before
+namespace Profiler {
+    bool IsEnabled();
+
+    // names this thread in the trace, main thread and workers call it once
+    void SetThreadName(const char* name);
+
+    // Recording is on from the start, a paused profiler only costs the flag check
+    void SetCapturing(bool capturing);
+    bool IsCapturing();
+
+    // Reads the other threads' buffers while they may still be writing, call it while they're idle
+    // (e.g. between frames) or expect a few torn events. Returns false if the file couldn't be written
+    bool WriteChromeTrace(const std::string& path);
+
+#ifdef ENABLE_PROFILER
+    // name has to outlive the profiler, string literals and __func__ do
+    void Record(const char* name, uint64_t start, uint64_t end);
+    uint64_t Now();
+    bool IsCapturingFast();
+
+    class Scope {
+        public:
+            explicit Scope(const char* name) : name(name), active(IsCapturingFast()), start(active ? Now() : 0) {}
+            ~Scope() {
+                if (active) Record(name, start, Now());
+            }
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            const char* name;
+            bool active;
+            uint64_t start;
+    };
+#endif
+}
+
+#ifdef ENABLE_PROFILER
+#define PROFILE_CONCATENATE_IMPL(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_IMPL(a, b)
+#define PROFILE_SCOPE(name) Profiler::Scope PROFILE_CONCATENATE(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#endif
+
+#endif
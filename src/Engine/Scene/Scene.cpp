@@ -13,69 +13,139 @@
 #include "../../Enums/Constants.h"
 
 #include "../../Engine/Window/Window.h"
-#include "../../Engine/Clock/Clock.h"
+#include "../../Engine/Profiler/Profiler.h"
 
 
 
-bool Scene::LoadModel(const std::string &path){
+bool Scene::LoadModel(const std::string &path, bool levelsOfDetail){
 
-    if(!modelLoader.LoadFromObj(path)){
+    MeshHandle mesh = LoadMesh(path, levelsOfDetail);
+    if(mesh == MeshRegistry::noMesh){
         return false;
     }
 
-    std::vector<Polygon3D<float, 3>> triangulatedTriangles;
-    triangulatedTriangles.reserve(modelLoader.quadrilaterals.size() * 2);
+    SceneGraph::Transform model;
+    model.translation = Vector<float, 3>(-0.5f, -0.5f, -0.5f);
+    AddInstance(mesh, model, pivotNode);
 
+    return true;
+}
 
-    for(auto& quad : modelLoader.quadrilaterals){
-        auto triangles = MathFunctions::Polygons::Triangulate<float, std::array<Vertex3<float>, 4>>(
-            quad.vertices, 
-            quad.GetNormal()
-        );
-        for(auto& tri : triangles){
-            triangulatedTriangles.push_back(tri);
-        }
+SceneGraph::NodeId Scene::AddInstance(MeshHandle mesh, const SceneGraph::Transform& local, SceneGraph::NodeId parent, uint32_t material){
+    SceneGraph::NodeId node = sceneGraph.AddNode(parent, local);
+
+    // after the last instance of the same mesh, so the renderer gets each mesh's instances as one run
+    auto position = std::find_if(instances.rbegin(), instances.rend(), [mesh](const MeshInstance& instance){
+        return instance.mesh == mesh;
+    }).base();
+    if(position == instances.begin()) position = instances.end();
+    instances.insert(position, { mesh, node, material });
+    instanceTreeStale = true;
+
+    return node;
 }
 
-    triangles.reserve(modelLoader.triangles.size() + modelLoader.quadrilaterals.size() * 2);
+uint32_t Scene::AddMaterial(const Material<float>& material){
+    materials.push_back(material);
+    return static_cast<uint32_t>(materials.size() - 1);
+}
 
-    for(auto& tri : modelLoader.triangles){
-        triangles.push_back(tri);
-    }
-    for(auto& tri : triangulatedTriangles){
-        triangles.push_back(tri);
-    }
+const Material<float>* Scene::GetMaterial(const MeshInstance& instance) const {
+    if(instance.material != noMaterial) return &materials[instance.material];
 
-    return true;
+    const std::vector<Material<float>>& meshMaterials = meshRegistry.Get(instance.mesh).materials;
+    return meshMaterials.empty() ? nullptr : &meshMaterials.front();
 }
 
+// the box around all of the mesh's levels, through the world matrix, boxed again
+void Scene::UpdateInstanceBounds(){
+    instanceBounds.resize(instances.size());
+
+    for(size_t i = 0; i < instances.size(); i++){
+        const Matrix<float, 4, 4>& worldMatrix = sceneGraph.GetWorldMatrix(instances[i].node);
+
+        // simplified levels can stick out a little past the full one
+        bool empty = true;
+        BoundingVolumeHierarchy<float>::Box meshBounds;
+        for(const MeshRegistry::Level& level : meshRegistry.Get(instances[i].mesh).levels){
+            if(level.clusterTree.IsEmpty()) continue;
+            const BoundingVolumeHierarchy<float>::Box& levelBounds = level.clusterTree.GetBounds();
+            if(empty) meshBounds = levelBounds;
+            for(int axis = 0; axis < 3; axis++){
+                meshBounds.boundsMin[axis] = std::min(meshBounds.boundsMin[axis], levelBounds.boundsMin[axis]);
+                meshBounds.boundsMax[axis] = std::max(meshBounds.boundsMax[axis], levelBounds.boundsMax[axis]);
+            }
+            empty = false;
+        }
 
-void Scene::Update(){
-    
-    
-    Clock &clock = Clock::GetInstance();
+        Vector<float, 3> corners[8];
+        if(empty){
+            for(Vector<float, 3>& corner : corners) corner = Vector<float, 3>(0.0f, 0.0f, 0.0f);
+        }
+        else{
+            for(int corner = 0; corner < 8; corner++){
+                corners[corner] = Vector<float, 3>(corner & 1 ? meshBounds.boundsMax[0] : meshBounds.boundsMin[0],
+                                                   corner & 2 ? meshBounds.boundsMax[1] : meshBounds.boundsMin[1],
+                                                   corner & 4 ? meshBounds.boundsMax[2] : meshBounds.boundsMin[2]);
+            }
+        }
+        MathFunctions::Matrices::TransformPoints(corners, worldMatrix, corners);
+
+        BoundingVolumeHierarchy<float>::Box& bounds = instanceBounds[i];
+        bounds.boundsMin = corners[0];
+        bounds.boundsMax = corners[0];
+        for(const Vector<float, 3>& corner : corners){
+            for(int axis = 0; axis < 3; axis++){
+                bounds.boundsMin[axis] = std::min(bounds.boundsMin[axis], corner[axis]);
+                bounds.boundsMax[axis] = std::max(bounds.boundsMax[axis], corner[axis]);
+            }
+        }
+    }
 
-    float t = clock.GetCurrentTime() / 1000.0f;
+    if(instanceTreeStale) instanceTree.Build(instanceBounds);
+    else instanceTree.Refit(instanceBounds);
+    instanceTreeStale = false;
+}
+
+void Scene::CollectVisibleInstances(const Frustum<float>& frustum, std::vector<uint32_t>& visible) const {
+    PROFILE_FUNCTION();
+    size_t first = visible.size();
+    instanceTree.Query(frustum, [&visible](uint32_t instance){ visible.push_back(instance); });
+    std::sort(visible.begin() + first, visible.end());
+}
 
-    std::cout<<"t = "<<t<<std::endl;
 
+void Scene::Step(float deltaTime){
+    PROFILE_FUNCTION();
+    animationTime += deltaTime;
 
+    float xAngle = 1.0f + animationTime;
+    float yAngle = 2.0f + animationTime * 0.2f;
+    float zAngle = 1.5f + animationTime * 0.2f;
 
-    float xAngle = 1.0f + t;
-    float yAngle = 2.0f + t * 0.2;
-    float zAngle = 1.5f + t * 0.2;
+    previousPivotRotation = currentPivotRotation;
+    currentPivotRotation = MathFunctions::Quaternions::FromEulerAngles(xAngle, yAngle, zAngle);
+}
 
-    
-    rotationMatrix = MathFunctions::Matrices::CreateRotationMatrix(xAngle, yAngle, zAngle); 
-    translationMatrix = MathFunctions::Matrices::CreateTranslationMatrix(0.0f, 0.0f, 0.0f);
-    worldMatrix = Constants::Matrices::translationToWorldCenterInverse * rotationMatrix * Constants::Matrices::translationToWorldCenter;
+void Scene::Interpolate(float alpha){
+    PROFILE_FUNCTION();
+    sceneGraph.SetRotation(pivotNode, MathFunctions::Quaternions::Slerp(previousPivotRotation, currentPivotRotation, alpha));
+    if(sceneGraph.Update() > 0 || instanceTreeStale) UpdateInstanceBounds();
 }
 
-Matrix<float, 4, 4> Scene::GetFinalTransformationMatrix(){
-    return translationMatrix * worldMatrix;
+void Scene::Update(float deltaTime){
+    Step(deltaTime);
+    Interpolate(1.0f);
 }
 
 Scene::Scene(){
-    Update();
+    // models spin around the middle of their unit box: the pivot sits there and rotates,
+    // LoadModel moves each model under it back by the same amount
+    SceneGraph::Transform pivot;
+    pivot.translation = Vector<float, 3>(0.5f, 0.5f, 0.5f);
+    pivotNode = sceneGraph.AddNode(SceneGraph::noNode, pivot);
+
+    Step(0.0f);
+    Update(0.0f);
 
 }
\ No newline at end of file
@@ -4,27 +4,87 @@
 
 #include <vector>
 #include <string>
-#include "../../Resources/ModelLoader/ModelLoader.h"
-#include "../../Core/Math/Matrix.h"
+#include <stdint.h>
+#include "../../Resources/MeshRegistry/MeshRegistry.h"
+#include "../../Core/Geometry/Material.h"
+#include "../../Core/Geometry/Frustum.h"
+#include "../../Core/Geometry/BoundingVolumeHierarchy.h"
+#include "../SceneGraph/SceneGraph.h"
 
 class Scene {
-    using Triangle3D = Polygon3D<float, 3>;
+    public:
+        using MeshHandle = MeshRegistry::MeshHandle;
+        static constexpr uint32_t noMaterial = UINT32_MAX;
+
+        // A placed copy of a registered mesh: which mesh, where it is, and optionally another material
+        struct MeshInstance {
+            MeshHandle mesh;
+            SceneGraph::NodeId node;
+            uint32_t material = noMaterial;     // into the scene's materials, noMaterial keeps the mesh's own
+        };
+
     private:
-        ModelLoader<float> modelLoader;
-        std::vector<Triangle3D> triangles;
-        Matrix<float, 4, 4> worldMatrix, rotationMatrix, translationMatrix;
+        MeshRegistry meshRegistry;
+        SceneGraph sceneGraph;
+        SceneGraph::NodeId pivotNode;
+        std::vector<Material<float>> materials;
+        std::vector<MeshInstance> instances;    // instances of the same mesh are kept next to each other
+
+        // World space boxes of the instances and a tree over them. Rebuilt when instances are added,
+        // refit when any transform changed
+        std::vector<BoundingVolumeHierarchy<float>::Box> instanceBounds;
+        BoundingVolumeHierarchy<float> instanceTree;
+        bool instanceTreeStale = true;
+
+        // the simulation's last two steps, rendering happens somewhere between them
+        float animationTime = 0.0f;
+        Quaternion<float> previousPivotRotation, currentPivotRotation;
+
+        void UpdateInstanceBounds();
 
     public:
         Scene();
-        bool LoadModel(const std::string& filepath);
-        void Update();
+        // Loads the model once and places a copy of it on the spinning pivot. levelsOfDetail also builds
+        // its simplified levels, the renderer then picks one per copy by its size on screen
+        bool LoadModel(const std::string& filepath, bool levelsOfDetail = false);
+        // Step advances the simulation by deltaTime, Interpolate poses the scene between the last two steps
+        // (alpha 0 is the previous one, 1 the latest) and brings world matrices and bounds up to date.
+        // Update is both at once, for a frame that is exactly one step
+        void Step(float deltaTime);
+        void Interpolate(float alpha);
+        void Update(float deltaTime);
+
+        MeshHandle LoadMesh(const std::string& filepath, bool levelsOfDetail = false) {
+            return meshRegistry.Load(filepath, levelsOfDetail);
+        };
+        // returns the instance's scene graph node, move the instance through it
+        SceneGraph::NodeId AddInstance(MeshHandle mesh, const SceneGraph::Transform& local,
+            SceneGraph::NodeId parent = SceneGraph::noNode, uint32_t material = noMaterial);
+        uint32_t AddMaterial(const Material<float>& material);
+
+        // Appends the indices into GetInstances() of every instance not entirely outside the frustum,
+        // in instance order so each mesh's instances stay together. As of the last Update()
+        void CollectVisibleInstances(const Frustum<float>& frustum, std::vector<uint32_t>& visible) const;
+
+        // the override, else the mesh's first material, nullptr if it has none
+        const Material<float>* GetMaterial(const MeshInstance& instance) const;
+
+        SceneGraph& GetSceneGraph() {
+            return sceneGraph;
+        };
+
+        const SceneGraph& GetSceneGraph() const {
+            return sceneGraph;
+        };
 
-        Matrix<float, 4, 4> GetFinalTransformationMatrix();
+        const MeshRegistry& GetMeshRegistry() const {
+            return meshRegistry;
+        };
 
-        const std::vector<Triangle3D>& GetTriangles() const {
-            return triangles;
+        const std::vector<MeshInstance>& GetInstances() const {
+            return instances;
         };
 };
 
 
-#endif
\ No newline at end of file
+#endif
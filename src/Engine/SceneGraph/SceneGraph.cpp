@@ -0,0 +1,91 @@
+#include <algorithm>
+#include "SceneGraph.h"
+#include "../../Core/Utilities/MathFunctions.h"
+
+
+SceneGraph::NodeId SceneGraph::AddNode(NodeId parent) {
+    return AddNode(parent, Transform());
+}
+
+SceneGraph::NodeId SceneGraph::AddNode(NodeId parent, const Transform& local) {
+    uint32_t parentPosition = parent == noNode ? noNode : positions[parent];
+    uint32_t position = parent == noNode ? static_cast<uint32_t>(nodeIds.size()) : parentPosition + subtreeSizes[parentPosition];
+    NodeId id = static_cast<NodeId>(positions.size());
+
+    // everything from position on shifts one place to make room
+    for (uint32_t& nodeParent : parents) {
+        if (nodeParent != noNode && nodeParent >= position) nodeParent++;
+    }
+    for (uint32_t i = position; i < nodeIds.size(); i++) positions[nodeIds[i]]++;
+    for (uint32_t ancestor = parentPosition; ancestor != noNode; ancestor = parents[ancestor]) subtreeSizes[ancestor]++;
+
+    localTransforms.insert(localTransforms.begin() + position, local);
+    worldMatrices.insert(worldMatrices.begin() + position, Matrix<float, 4, 4>());
+    parents.insert(parents.begin() + position, parentPosition);
+    subtreeSizes.insert(subtreeSizes.begin() + position, 1);
+    nodeIds.insert(nodeIds.begin() + position, id);
+    dirty.insert(dirty.begin() + position, 0);
+    positions.push_back(position);
+
+    MarkDirty(position);
+    return id;
+}
+
+void SceneGraph::SetLocalTransform(NodeId node, const Transform& local) {
+    localTransforms[positions[node]] = local;
+    MarkDirty(positions[node]);
+}
+
+void SceneGraph::SetTranslation(NodeId node, const Vector<float, 3>& translation) {
+    localTransforms[positions[node]].translation = translation;
+    MarkDirty(positions[node]);
+}
+
+void SceneGraph::SetRotation(NodeId node, const Quaternion<float>& rotation) {
+    localTransforms[positions[node]].rotation = rotation;
+    MarkDirty(positions[node]);
+}
+
+void SceneGraph::SetScale(NodeId node, const Vector<float, 3>& scale) {
+    localTransforms[positions[node]].scale = scale;
+    MarkDirty(positions[node]);
+}
+
+SceneGraph::NodeId SceneGraph::GetParent(NodeId node) const {
+    uint32_t parentPosition = parents[positions[node]];
+    return parentPosition == noNode ? noNode : nodeIds[parentPosition];
+}
+
+void SceneGraph::MarkDirty(uint32_t position) {
+    if (dirty[position]) return;
+    dirty[position] = 1;
+    dirtyNodes.push_back(nodeIds[position]);
+}
+
+
+size_t SceneGraph::Update() {
+    if (dirtyNodes.empty()) return 0;
+
+    // sorted, an ancestor's range comes first and already covers every marked node inside it
+    dirtyPositions.clear();
+    for (NodeId node : dirtyNodes) dirtyPositions.push_back(positions[node]);
+    std::sort(dirtyPositions.begin(), dirtyPositions.end());
+    dirtyNodes.clear();
+
+    size_t recomputed = 0;
+    uint32_t coveredEnd = 0;
+    for (uint32_t root : dirtyPositions) {
+        if (root < coveredEnd) continue;
+        coveredEnd = root + subtreeSizes[root];
+
+        // parents come first, so each one is final by the time its children read it
+        for (uint32_t i = root; i < coveredEnd; i++) {
+            const Transform& local = localTransforms[i];
+            Matrix<float, 4, 4> localMatrix = MathFunctions::Matrices::CreateTransformMatrix(local.translation, local.rotation, local.scale);
+            worldMatrices[i] = parents[i] == noNode ? localMatrix : worldMatrices[parents[i]] * localMatrix;
+            dirty[i] = 0;
+        }
+        recomputed += coveredEnd - root;
+    }
+    return recomputed;
+}
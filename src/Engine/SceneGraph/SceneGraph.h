@@ -0,0 +1,62 @@
+#ifndef SCENE_GRAPH_H
+#define SCENE_GRAPH_H
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+#include "../../Core/Math/Vector.h"
+#include "../../Core/Math/Matrix.h"
+#include "../../Core/Math/Quaternion.h"
+
+
+// Tree of node transforms. Nodes sit in flat arrays in depth-first order: every parent comes before its
+// children and a subtree is the contiguous range starting at its root.
+// Setting a local transform only marks the node, Update() then recomputes the world matrices of the marked
+// subtrees in one forward pass over the arrays. Nothing marked, nothing done
+class SceneGraph {
+    public:
+        using NodeId = uint32_t;
+        static constexpr NodeId noNode = UINT32_MAX;
+
+        // translation * rotation * scale, rotation is a unit quaternion
+        struct Transform {
+            Vector<float, 3> translation;
+            Quaternion<float> rotation = Quaternion<float>(1.0f, 0.0f, 0.0f, 0.0f);
+            Vector<float, 3> scale = Vector<float, 3>(1.0f, 1.0f, 1.0f);
+        };
+
+        // The new node goes after parent's other descendants. Ids stay valid while nodes move in the arrays
+        NodeId AddNode(NodeId parent, const Transform& local);
+        NodeId AddNode(NodeId parent = noNode);
+
+        const Transform& GetLocalTransform(NodeId node) const { return localTransforms[positions[node]]; }
+        void SetLocalTransform(NodeId node, const Transform& local);
+        void SetTranslation(NodeId node, const Vector<float, 3>& translation);
+        void SetRotation(NodeId node, const Quaternion<float>& rotation);
+        void SetScale(NodeId node, const Vector<float, 3>& scale);
+
+        // parent's world matrix * local matrix, current as of the last Update()
+        const Matrix<float, 4, 4>& GetWorldMatrix(NodeId node) const { return worldMatrices[positions[node]]; }
+        NodeId GetParent(NodeId node) const;
+        size_t GetNodeCount() const { return nodeIds.size(); }
+
+        // returns how many world matrices it recomputed
+        size_t Update();
+
+    private:
+        void MarkDirty(uint32_t position);
+
+        // by position in depth-first order
+        std::vector<Transform> localTransforms;
+        std::vector<Matrix<float, 4, 4>> worldMatrices;
+        std::vector<uint32_t> parents;          // position of the parent, noNode for roots
+        std::vector<uint32_t> subtreeSizes;     // the node and all of its descendants
+        std::vector<NodeId> nodeIds;
+        std::vector<uint8_t> dirty;
+
+        std::vector<uint32_t> positions;        // by NodeId
+        std::vector<NodeId> dirtyNodes;         // marked since the last Update
+        std::vector<uint32_t> dirtyPositions;   // Update scratch, kept for its capacity
+};
+
+#endif
@@ -0,0 +1,81 @@
+#include <algorithm>
+#include "ThreadPool.h"
+#include "../Profiler/Profiler.h"
+
+
+namespace {
+    thread_local bool insideJob = false;
+}
+
+
+ThreadPool::ThreadPool() {
+    size_t hardwareThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    for(size_t i = 1; i < hardwareThreads; i++){
+        threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    jobReady.notify_all();
+    for(auto& thread : threads) thread.join();
+}
+
+
+void ThreadPool::ParallelFor(size_t count, const Job& job) {
+    if(count == 0) return;
+
+    if(insideJob || threads.empty() || count == 1){
+        for(size_t i = 0; i < count; i++) job(i, 0);
+        return;
+    }
+
+    std::lock_guard<std::mutex> dispatchLock(dispatchMutex);
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        currentJob = &job;
+        jobCount = count;
+        nextIndex.store(0, std::memory_order_relaxed);
+        busyWorkers = threads.size();
+        generation++;
+    }
+    jobReady.notify_all();
+
+    RunJobs(0);
+
+    std::unique_lock<std::mutex> lock(stateMutex);
+    jobFinished.wait(lock, [this]{ return busyWorkers == 0; });
+    currentJob = nullptr;
+}
+
+
+void ThreadPool::WorkerLoop(size_t workerIndex) {
+    Profiler::SetThreadName("ThreadPool worker");
+    size_t seenGeneration = 0;
+    while(true){
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            jobReady.wait(lock, [&]{ return stopping || generation != seenGeneration; });
+            if(stopping) return;
+            seenGeneration = generation;
+        }
+
+        RunJobs(workerIndex);
+
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if(--busyWorkers == 0) jobFinished.notify_one();
+    }
+}
+
+
+// indices are handed out one at a time, so uneven jobs (e.g. crowded screen tiles) still balance
+void ThreadPool::RunJobs(size_t workerIndex) {
+    insideJob = true;
+    for(size_t i = nextIndex.fetch_add(1); i < jobCount; i = nextIndex.fetch_add(1)){
+        (*currentJob)(i, workerIndex);
+    }
+    insideJob = false;
+}
@@ -0,0 +1,55 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stddef.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+
+// Persistent worker threads for data parallel loops.
+// The calling thread works too, so GetWorkerCount() == hardware threads
+class ThreadPool {
+    public:
+        using Job = std::function<void(size_t index, size_t workerIndex)>;
+
+        static ThreadPool& GetInstance() {
+            static ThreadPool instance;
+            return instance;
+        }
+
+        // Runs job(i, workerIndex) for every i in [0, count) and returns once all of them finished.
+        // workerIndex is < GetWorkerCount() and unique among the threads running at the same time, handy for per-worker scratch.
+        // Calls made from inside a job run inline on the calling worker, calls from another thread outside the
+        // pool wait until the running one is done
+        void ParallelFor(size_t count, const Job& job);
+
+        size_t GetWorkerCount() const { return threads.size() + 1; }
+
+    private:
+        ThreadPool();
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        void WorkerLoop(size_t workerIndex);
+        void RunJobs(size_t workerIndex);
+
+        std::vector<std::thread> threads;
+
+        std::mutex dispatchMutex;   // one ParallelFor at a time, calls from other threads wait for it to finish
+        std::mutex stateMutex;
+        std::condition_variable jobReady, jobFinished;
+
+        const Job* currentJob = nullptr;
+        size_t jobCount = 0;
+        std::atomic<size_t> nextIndex{0};
+        size_t generation = 0;
+        size_t busyWorkers = 0;
+        bool stopping = false;
+};
+
+#endif
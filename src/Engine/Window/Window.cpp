@@ -28,7 +28,7 @@ bool Window::Init() {
         return false;
     }
 
-    renderer2D = new Renderer2D(renderer);
+    renderer2D = new Renderer2D(renderer, width, height);
     renderer3D = new Renderer3D(renderer2D, width, height);
     windowId = SDL_GetWindowID(window);
 
@@ -90,6 +90,8 @@ void Window::Resize(int newWidth, int newHeight){
     SDL_SetWindowSize(window, newWidth, newHeight);
     width = newWidth;
     height = newHeight;
+    if(renderer2D) renderer2D->Resize(width, height);
+    if(renderer3D) renderer3D->SetWindowDimensions(width, height);
 }
 
 
@@ -0,0 +1,54 @@
+#include "Worker.h"
+#include "../FrameArena/FrameArena.h"
+#include "../Profiler/Profiler.h"
+
+
+Worker::Worker() : thread(&Worker::Loop, this) {}
+
+Worker::~Worker() {
+    Wait();
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    jobReady.notify_one();
+    thread.join();
+}
+
+
+void Worker::Run(const Job& job) {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    jobFinished.wait(lock, [this]{ return currentJob == nullptr; });
+    currentJob = &job;
+    lock.unlock();
+    jobReady.notify_one();
+}
+
+void Worker::Wait() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    jobFinished.wait(lock, [this]{ return currentJob == nullptr; });
+}
+
+
+void Worker::Loop() {
+    Profiler::SetThreadName("Worker");
+    while(true){
+        const Job* job;
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            jobReady.wait(lock, [this]{ return stopping || currentJob != nullptr; });
+            if(stopping) return;
+            job = currentJob;
+        }
+
+        (*job)();
+        // nothing the job allocated from this thread's arena outlives it
+        FrameArena::GetInstance().Reset();
+
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            currentJob = nullptr;
+        }
+        jobFinished.notify_all();
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef WORKER_H
+#define WORKER_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+
+// One persistent thread for a job that runs next to the main thread, e.g. a window's rasterization.
+// Run hands the job over and returns at once, Wait blocks until it finished. The job is only referenced,
+// it has to stay alive until Wait returns. The worker resets its own FrameArena after every job
+class Worker {
+    public:
+        using Job = std::function<void()>;
+
+        Worker();
+        ~Worker();
+        Worker(const Worker&) = delete;
+        Worker& operator=(const Worker&) = delete;
+
+        // waits for the previous job first
+        void Run(const Job& job);
+        void Wait();
+
+    private:
+        void Loop();
+
+        std::mutex stateMutex;
+        std::condition_variable jobReady, jobFinished;
+        const Job* currentJob = nullptr;
+        bool stopping = false;
+
+        std::thread thread;     // last, starts once everything above exists
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define CONSTANTS_H
 
 #include "../Core/Math/Matrix.h"
+#include "../Core/Utilities/MathFunctions.h"
 
 namespace Constants{
     namespace Projection{
@@ -15,19 +16,12 @@ namespace Constants{
     }
 
     namespace Matrices{
-        inline const Matrix<float,4,4> translationToWorldCenter = {
-            1, 0, 0, -0.5,
-            0, 1, 0, -0.5,
-            0, 0, 1, -0.5,
-            0, 0, 0, 1
-        };
-
-        inline const Matrix<float,4,4> translationToWorldCenterInverse = {
-            1, 0, 0, 0.5,
-            0, 1, 0, 0.5,
-            0, 0, 1, 0.5,
-            0, 0, 0, 1
-        };
+        // built at compile time, no constructor runs at startup
+        inline constexpr Matrix<float,4,4> translationToWorldCenter = MathFunctions::Matrices::CreateTranslationMatrix(-0.5f, -0.5f, -0.5f);
+        inline constexpr Matrix<float,4,4> translationToWorldCenterInverse = MathFunctions::Matrices::QuickMatrixInverse(translationToWorldCenter);
+
+        static_assert((translationToWorldCenterInverse * translationToWorldCenter)(0, 3) == 0.0f &&
+                      translationToWorldCenterInverse(2, 3) == 0.5f, "translationToWorldCenterInverse has to undo translationToWorldCenter");
     }
 }
 
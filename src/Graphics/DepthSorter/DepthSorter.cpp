@@ -0,0 +1,175 @@
+#include <string.h>
+#include <numeric>
+#include <algorithm>
+#include "DepthSorter.h"
+
+
+uint32_t DepthSorter::ToKey(float depth) {
+    uint32_t bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    // positive floats already compare like integers once the sign bit is set, negative ones compare reversed
+    return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+
+void DepthSorter::Reserve(size_t count) {
+    for (std::vector<uint32_t>* buffer : { &keys, &order, &scratchOrder, &sortedKeys, &scratchKeys, &newItems }) buffer->reserve(count);
+    previousIds.reserve(count);
+    previousMatches.reserve(count);
+    previousRuns.reserve(count);
+}
+
+
+const std::vector<uint32_t>& DepthSorter::Sort(const std::vector<float>& depths, std::span<const uint64_t> ids, Direction direction) {
+    size_t count = depths.size();
+    uint32_t flip = direction == Direction::FrontToBack ? ~0u : 0u;
+
+    keys.resize(count);
+    for (size_t i = 0; i < count; i++) keys[i] = ToKey(depths[i]) ^ flip;
+
+    reusedPreviousOrder = temporalCoherence && count > 0 && CarryOverPreviousOrder(ids) && FinishNearlySorted();
+    if (reusedPreviousOrder) MergeNewItems();
+    else RadixSort();
+
+    previousIds.clear();
+    previousRuns.clear();
+    if (temporalCoherence && ids.size() == count) {
+        previousIds.assign(ids.begin(), ids.end());
+        for (size_t i = 0; i < count; i++) {
+            if (i == 0 || ids[i] >> 32 != ids[i - 1] >> 32) previousRuns.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    return order;
+}
+
+
+// Last call's order over this call's items. The ids of both calls are walked in submission order: within a run
+// last call's ids ascend, so each id is searched for by galloping ahead from the last match, a run whose upper
+// bits aren't next is looked up among last call's runs. Items found take the place theirs had in order,
+// the rest go to newItems. False when there's nothing to carry over or too much is new
+bool DepthSorter::CarryOverPreviousOrder(std::span<const uint64_t> ids) {
+    const size_t count = keys.size(), previousCount = previousIds.size();
+    if (ids.size() != count || previousCount == 0 || order.size() != previousCount) return false;
+
+    previousMatches.assign(previousCount, noItem);
+    newItems.clear();
+    size_t previous = 0, run = 0, runEnd = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const uint64_t id = ids[i], upper = id >> 32;
+        if (i == 0 || upper != ids[i - 1] >> 32) {
+            // runs come in the same order, so the search starts after the last one found
+            bool found = previous < previousCount && previousIds[previous] >> 32 == upper;
+            for (size_t tried = 0; !found && tried < previousRuns.size(); tried++) {
+                run = run + 1 < previousRuns.size() ? run + 1 : 0;
+                previous = previousRuns[run];
+                found = previousIds[previous] >> 32 == upper;
+            }
+            if (!found) previous = previousCount;
+            runEnd = previous;
+            while (runEnd < previousCount && previousIds[runEnd] >> 32 == upper) runEnd++;
+        }
+
+        // first of last call's ids in [previous, runEnd) not below id
+        size_t low = previous, step = 1;
+        while (low + step < runEnd && previousIds[low + step] < id) {
+            low += step;
+            step *= 2;
+        }
+        size_t high = std::min(low + step, runEnd);
+        low = std::lower_bound(previousIds.begin() + low, previousIds.begin() + high, id) - previousIds.begin();
+
+        if (low < runEnd && previousIds[low] == id) {
+            previousMatches[low] = i;
+            previous = low + 1;
+        }
+        else newItems.push_back(i);
+    }
+    if (newItems.size() > count / maxNewFraction) return false;
+
+    scratchOrder.clear();
+    for (uint32_t previousItem : order) {
+        if (previousMatches[previousItem] != noItem) scratchOrder.push_back(previousMatches[previousItem]);
+    }
+    order.swap(scratchOrder);
+    return true;
+}
+
+
+// The few items last call didn't have are sorted on their own and merged in, equal keys after the carried ones
+void DepthSorter::MergeNewItems() {
+    if (newItems.empty()) return;
+    std::sort(newItems.begin(), newItems.end(), [this](uint32_t left, uint32_t right) {
+        return keys[left] != keys[right] ? keys[left] < keys[right] : left < right;
+    });
+    scratchOrder.resize(order.size() + newItems.size());
+    std::merge(order.begin(), order.end(), newItems.begin(), newItems.end(), scratchOrder.begin(),
+        [this](uint32_t left, uint32_t right) { return keys[left] < keys[right]; });
+    order.swap(scratchOrder);
+}
+
+
+// Insertion sort starting from the previous order, false once it has done more work than a radix sort would
+bool DepthSorter::FinishNearlySorted() {
+    size_t count = order.size();
+    sortedKeys.resize(count);
+    for (size_t i = 0; i < count; i++) sortedKeys[i] = keys[order[i]];
+
+    size_t shiftBudget = count * maxShiftsPerItem;
+    for (size_t i = 1; i < count; i++) {
+        uint32_t key = sortedKeys[i], index = order[i];
+        size_t j = i;
+        while (j > 0 && sortedKeys[j - 1] > key) {
+            sortedKeys[j] = sortedKeys[j - 1];
+            order[j] = order[j - 1];
+            j--;
+            if (--shiftBudget == 0) {
+                sortedKeys[j] = key;    // keep order a permutation, the radix sort rebuilds it anyway
+                order[j] = index;
+                return false;
+            }
+        }
+        sortedKeys[j] = key;
+        order[j] = index;
+    }
+    return true;
+}
+
+
+// LSD radix sort of (key, index) pairs, stable so equal depths keep submission order.
+// All histograms come from one pass over the keys and digits every key shares are skipped
+void DepthSorter::RadixSort() {
+    constexpr int passCount = 32 / radixBits;
+    size_t count = keys.size();
+
+    order.resize(count);
+    std::iota(order.begin(), order.end(), 0u);
+    sortedKeys = keys;
+    scratchOrder.resize(count);
+    scratchKeys.resize(count);
+
+    size_t histograms[passCount][bucketCount] = {};
+    for (uint32_t key : keys) {
+        for (int pass = 0; pass < passCount; pass++) histograms[pass][(key >> (pass * radixBits)) & (bucketCount - 1)]++;
+    }
+
+    for (int pass = 0; pass < passCount; pass++) {
+        size_t* histogram = histograms[pass];
+        int shift = pass * radixBits;
+        if (histogram[(sortedKeys.empty() ? 0 : sortedKeys[0] >> shift) & (bucketCount - 1)] == count) continue;
+
+        size_t offset = 0;
+        for (int bucket = 0; bucket < bucketCount; bucket++) {
+            size_t bucketSize = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketSize;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            size_t destination = histogram[(sortedKeys[i] >> shift) & (bucketCount - 1)]++;
+            scratchKeys[destination] = sortedKeys[i];
+            scratchOrder[destination] = order[i];
+        }
+        sortedKeys.swap(scratchKeys);
+        order.swap(scratchOrder);
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef DEPTH_SORTER_H
+#define DEPTH_SORTER_H
+
+#include <vector>
+#include <span>
+#include <stddef.h>
+#include <stdint.h>
+
+
+// Orders triangles by depth without touching the triangles themselves.
+// Every depth becomes one 32 bit key that sorts like the float, and (key, index) pairs go through an LSD radix sort.
+// With temporal coherence the previous call's order is tried first: items are matched to last call's by id,
+// so culling, clipping or a changed count don't shift it. When the view barely moved it is almost sorted
+// already and a bounded insertion sort finishes it, items new since last call are sorted apart and merged in.
+// Otherwise the radix sort takes over
+class DepthSorter {
+    public:
+        enum class Direction { BackToFront, FrontToBack };  // larger depth is nearer
+
+        // Indices into depths in drawing order, valid until the next call. ids are parallel to depths and name
+        // the same item from call to call. Matching walks both calls in submission order, so ids sharing their
+        // upper 32 bits should come as one run in ascending order, runs in the same order each call. Ids that
+        // don't only cost the previous order, the result is sorted either way
+        const std::vector<uint32_t>& Sort(const std::vector<float>& depths, std::span<const uint64_t> ids, Direction direction);
+
+        // sizes the buffers up front, sorting up to count items then never allocates
+        void Reserve(size_t count);
+
+        void SetTemporalCoherence(bool enabled) { temporalCoherence = enabled; }
+        bool ReusedPreviousOrder() const { return reusedPreviousOrder; }
+
+        // float to unsigned key with the same ordering, negative numbers included
+        static uint32_t ToKey(float depth);
+
+    private:
+        // insertion sort gives up once it has shifted this many elements per item on average
+        static constexpr size_t maxShiftsPerItem = 4;
+        // more than one item in this many without a match in the previous call and the radix sort is quicker
+        static constexpr size_t maxNewFraction = 8;
+        static constexpr int radixBits = 8;
+        static constexpr int bucketCount = 1 << radixBits;
+        static constexpr uint32_t noItem = UINT32_MAX;
+
+        bool temporalCoherence = true;
+        bool reusedPreviousOrder = false;
+
+        std::vector<uint32_t> keys;             // per item, indexed like depths
+        std::vector<uint32_t> order, scratchOrder;
+        std::vector<uint32_t> sortedKeys, scratchKeys;
+
+        // last call's ids in submission order, order still holds where they were drawn
+        std::vector<uint64_t> previousIds;
+        std::vector<uint32_t> previousRuns;     // where each run of equal upper 32 bits starts in previousIds
+        std::vector<uint32_t> previousMatches;  // per item of last call, this call's item with its id or noItem
+        std::vector<uint32_t> newItems;         // this call's items nothing matched
+
+        bool CarryOverPreviousOrder(std::span<const uint64_t> ids);
+        bool FinishNearlySorted();
+        void MergeNewItems();
+        void RadixSort();
+};
+
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef DEPTHBUFFER_H
+#define DEPTHBUFFER_H
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include "Framebuffer.h"
+#include "../../Core/Utilities/AlignedAllocator.h"
+
+
+// Per-pixel float depth, laid out with the same padded rows as Framebuffer.
+// Stores projected z; the pipeline puts nearer fragments at larger z (same order the painter's sort uses),
+// so a cleared buffer holds the lowest float and a fragment passes when its z is >= the stored one
+class DepthBuffer {
+    public:
+        static constexpr float clearDepth = std::numeric_limits<float>::lowest();
+
+        DepthBuffer(int width, int height) {
+            Resize(width, height);
+        }
+
+        void Resize(int newWidth, int newHeight) {
+            width = std::max(newWidth, 0);
+            height = std::max(newHeight, 0);
+            stride = (width + Framebuffer::pixelsPerCacheLine - 1) / Framebuffer::pixelsPerCacheLine * Framebuffer::pixelsPerCacheLine;
+            depths.assign(size_t(stride) * height, clearDepth);
+        }
+
+        void Clear() {
+            std::fill(depths.begin(), depths.end(), clearDepth);
+        }
+
+        int GetWidth() const { return width; }
+        int GetHeight() const { return height; }
+        int GetStride() const { return stride; }   // in floats, same as the framebuffer's
+
+        float* Row(int y) { return depths.data() + size_t(y) * stride; }
+        const float* Row(int y) const { return depths.data() + size_t(y) * stride; }
+
+        float GetDepth(int x, int y) const {
+            return Row(y)[x];
+        }
+
+    private:
+        int width = 0, height = 0, stride = 0;
+        std::vector<float, AlignedAllocator<float, Framebuffer::cacheLineSize>> depths;
+};
+
+
+#endif
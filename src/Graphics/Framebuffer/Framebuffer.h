@@ -0,0 +1,141 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include "../../Core/Utilities/AlignedAllocator.h"
+
+
+// CPU side color buffer of packed ARGB8888 pixels.
+// Every row starts on a cache line, so it can be uploaded to a streaming SDL_Texture as is
+class Framebuffer {
+    public:
+        static constexpr size_t cacheLineSize = 64;
+        static constexpr int pixelsPerCacheLine = cacheLineSize / sizeof(uint32_t);
+
+        static uint32_t PackColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255) {
+            return (uint32_t(a) << 24) | (uint32_t(r) << 16) | (uint32_t(g) << 8) | uint32_t(b);
+        }
+
+        Framebuffer(int width, int height) {
+            Resize(width, height);
+        }
+
+        void Resize(int newWidth, int newHeight) {
+            width = std::max(newWidth, 0);
+            height = std::max(newHeight, 0);
+            stride = (width + pixelsPerCacheLine - 1) / pixelsPerCacheLine * pixelsPerCacheLine;
+            pixels.assign(size_t(stride) * height, 0);
+        }
+
+        void Clear(uint32_t color) {
+            std::fill(pixels.begin(), pixels.end(), color);
+        }
+
+        int GetWidth() const { return width; }
+        int GetHeight() const { return height; }
+        int GetStride() const { return stride; }                                  // in pixels
+        int GetPitch() const { return stride * static_cast<int>(sizeof(uint32_t)); }  // in bytes, as SDL wants it
+
+        const uint32_t* GetPixels() const { return pixels.data(); }
+        uint32_t* Row(int y) { return pixels.data() + size_t(y) * stride; }
+        const uint32_t* Row(int y) const { return pixels.data() + size_t(y) * stride; }
+
+        uint32_t GetPixel(int x, int y) const {
+            return Row(y)[x];
+        }
+
+        void SetPixel(int x, int y, uint32_t color) {
+            if (x < 0 || y < 0 || x >= width || y >= height) return;
+            Row(y)[x] = color;
+        }
+
+        // horizontal run of pixels from xStart to xEnd inclusive
+        void FillSpan(int y, int xStart, int xEnd, uint32_t color) {
+            if (y < 0 || y >= height) return;
+            if (xStart > xEnd) std::swap(xStart, xEnd);
+            xStart = std::max(xStart, 0);
+            xEnd = std::min(xEnd, width - 1);
+            if (xStart > xEnd) return;
+            std::fill_n(Row(y) + xStart, xEnd - xStart + 1, color);
+        }
+
+        // fills [x1, x2) x [y1, y2) the same way SDL_RenderFillRect does
+        void FillRect(int x1, int y1, int x2, int y2, uint32_t color) {
+            y1 = std::max(y1, 0);
+            y2 = std::min(y2, height);
+            for (int y = y1; y < y2; y++) FillSpan(y, x1, x2 - 1, color);
+        }
+
+        void DrawRect(int x, int y, int w, int h, uint32_t color) {
+            if (w <= 0 || h <= 0) return;
+            FillSpan(y, x, x + w - 1, color);
+            FillSpan(y + h - 1, x, x + w - 1, color);
+            for (int row = y + 1; row < y + h - 1; row++) {
+                SetPixel(x, row, color);
+                SetPixel(x + w - 1, row, color);
+            }
+        }
+
+        // Bresenham line, clipped against the buffer first so off-screen endpoints don't cost a pixel walk
+        void DrawLine(float x1, float y1, float x2, float y2, uint32_t color) {
+            ForEachLinePixel(x1, y1, x2, y2, [this, color](int x, int y) { Row(y)[x] = color; });
+        }
+
+        // calls pixelFunction(x, y) for every on-screen pixel of the line
+        template <typename PixelFunction>
+        void ForEachLinePixel(float x1, float y1, float x2, float y2, PixelFunction pixelFunction) const {
+            if (!ClipLine(x1, y1, x2, y2)) return;
+
+            int xStart = static_cast<int>(std::round(x1)), yStart = static_cast<int>(std::round(y1));
+            int xEnd = static_cast<int>(std::round(x2)), yEnd = static_cast<int>(std::round(y2));
+
+            int dx = std::abs(xEnd - xStart), dy = -std::abs(yEnd - yStart);
+            int stepX = xStart < xEnd ? 1 : -1, stepY = yStart < yEnd ? 1 : -1;
+            int error = dx + dy;
+
+            while (true) {
+                pixelFunction(xStart, yStart);
+                if (xStart == xEnd && yStart == yEnd) break;
+                int doubledError = 2 * error;
+                if (doubledError >= dy) { error += dy; xStart += stepX; }
+                if (doubledError <= dx) { error += dx; yStart += stepY; }
+            }
+        }
+
+    private:
+        int width = 0, height = 0, stride = 0;
+        std::vector<uint32_t, AlignedAllocator<uint32_t, cacheLineSize>> pixels;
+
+        // Liang-Barsky clip of a segment against [0, width-1] x [0, height-1]
+        bool ClipLine(float &x1, float &y1, float &x2, float &y2) const {
+            if (width == 0 || height == 0) return false;
+            float dx = x2 - x1, dy = y2 - y1;
+            float tEnter = 0.0f, tExit = 1.0f;
+            const float p[4] = { -dx, dx, -dy, dy };
+            const float q[4] = { x1, (width - 1) - x1, y1, (height - 1) - y1 };
+
+            for (int i = 0; i < 4; i++) {
+                if (p[i] == 0.0f) {
+                    if (q[i] < 0.0f) return false;
+                    continue;
+                }
+                float t = q[i] / p[i];
+                if (p[i] < 0.0f) tEnter = std::max(tEnter, t);
+                else tExit = std::min(tExit, t);
+                if (tEnter > tExit) return false;
+            }
+
+            float startX = x1, startY = y1;
+            x1 = startX + tEnter * dx;
+            y1 = startY + tEnter * dy;
+            x2 = startX + tExit * dx;
+            y2 = startY + tExit * dy;
+            return true;
+        }
+};
+
+
+#endif
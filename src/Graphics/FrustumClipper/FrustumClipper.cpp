@@ -0,0 +1,130 @@
+#include <algorithm>
+#include "FrustumClipper.h"
+
+
+void FrustumClipper::SetViewport(float width, float height) {
+    guardBandX = 1.0f + 2.0f * guardBandPixels / std::max(width, 1.0f);
+    guardBandY = 1.0f + 2.0f * guardBandPixels / std::max(height, 1.0f);
+}
+
+
+float FrustumClipper::Distance(const Vector4& position, int plane) const {
+    float depth = -position[3];
+    switch (plane) {
+        case Near:        return depth - nearPlane;
+        case Far:         return farPlane - depth;
+        case Left:        return depth - position[0];
+        case Right:       return depth + position[0];
+        case Bottom:      return depth - position[1];
+        case Top:         return depth + position[1];
+        case GuardLeft:   return guardBandX * depth - position[0];
+        case GuardRight:  return guardBandX * depth + position[0];
+        case GuardBottom: return guardBandY * depth - position[1];
+        default:          return guardBandY * depth + position[1];
+    }
+}
+
+// one bit per plane the point is outside of
+uint32_t FrustumClipper::Outcode(const Vector4& position) const {
+    uint32_t code = 0;
+    for (int plane = 0; plane < PlaneCount; plane++) {
+        if (Distance(position, plane) < 0.0f) code |= 1 << plane;
+    }
+    return code;
+}
+
+FrustumClipper::Vector3 FrustumClipper::Divide(const Vector4& position) {
+    return Vector3(position[0] / position[3], position[1] / position[3], position[2] / position[3]);
+}
+
+FrustumClipper::ClipVertex FrustumClipper::Interpolate(const ClipVertex& a, const ClipVertex& b, float t) {
+    return {
+        a.position + (b.position - a.position) * t,
+        a.normal + (b.normal - a.normal) * t,
+        a.textureCoordinates + (b.textureCoordinates - a.textureCoordinates) * t
+    };
+}
+
+
+FrustumClipper::TransformedVertex FrustumClipper::Transform(const Vector3& position, const Matrix<float, 4, 4>& matrix) const {
+    return FromClipSpace(Vector4(position[0], position[1], position[2], 1.0f) * matrix);
+}
+
+FrustumClipper::TransformedVertex FrustumClipper::FromClipSpace(const Vector4& position) const {
+    return { position, Divide(position), Outcode(position) };
+}
+
+
+FrustumClipper::Result FrustumClipper::Clip(const Triangle3D& triangle, const Matrix<float, 4, 4>& matrix, FrameVector<Triangle3D>& output) const {
+    TransformedVertex transformed[3];
+    for (int i = 0; i < 3; i++) transformed[i] = Transform(triangle.vertices[i].position, matrix);
+
+    const Vertex* const vertices[3] = { &triangle.vertices[0], &triangle.vertices[1], &triangle.vertices[2] };
+    const TransformedVertex* const corners[3] = { &transformed[0], &transformed[1], &transformed[2] };
+    return Clip(vertices, corners, output);
+}
+
+FrustumClipper::Result FrustumClipper::Clip(const Vertex* const vertices[3], const TransformedVertex* const transformed[3], FrameVector<Triangle3D>& output) const {
+    uint32_t codes[3] = { transformed[0]->outcode, transformed[1]->outcode, transformed[2]->outcode };
+
+    // all corners beyond the same plane, nothing of it can be on screen
+    if (codes[0] & codes[1] & codes[2] & frustumPlanes) return Result::Outside;
+
+    uint32_t planesToClip = (codes[0] | codes[1] | codes[2]) & clippingPlanes;
+    if (!planesToClip) {
+        std::array<Triangle3D::Vertex, 3> divided;
+        for (int i = 0; i < 3; i++) {
+            divided[i] = Triangle3D::Vertex(transformed[i]->divided, vertices[i]->normal, vertices[i]->textureCoordinates);
+        }
+        output.emplace_back(divided);
+        return Result::Inside;
+    }
+
+    ClipVertex corners[3];
+    for (int i = 0; i < 3; i++) {
+        corners[i] = { transformed[i]->position, vertices[i]->normal, vertices[i]->textureCoordinates };
+    }
+
+    // Sutherland-Hodgman, one plane at a time
+    ClipVertex buffers[2][maxClippedVertices];
+    ClipVertex* polygon = buffers[0];
+    ClipVertex* clipped = buffers[1];
+    int vertexCount = 3;
+    std::copy(corners, corners + 3, polygon);
+
+    for (int plane = 0; plane < PlaneCount && vertexCount >= 3; plane++) {
+        if (!(planesToClip & (1 << plane))) continue;
+
+        int clippedCount = 0;
+        for (int i = 0; i < vertexCount; i++) {
+            const ClipVertex& previous = polygon[(i + vertexCount - 1) % vertexCount];
+            const ClipVertex& current = polygon[i];
+            float previousDistance = Distance(previous.position, plane);
+            float currentDistance = Distance(current.position, plane);
+
+            // interpolated from the inside corner outwards, so triangles sharing the edge get the same point
+            if ((previousDistance >= 0.0f) != (currentDistance >= 0.0f)) {
+                clipped[clippedCount++] = previousDistance >= 0.0f
+                    ? Interpolate(previous, current, previousDistance / (previousDistance - currentDistance))
+                    : Interpolate(current, previous, currentDistance / (currentDistance - previousDistance));
+            }
+            if (currentDistance >= 0.0f) clipped[clippedCount++] = current;
+        }
+
+        std::swap(polygon, clipped);
+        vertexCount = clippedCount;
+    }
+    if (vertexCount < 3) return Result::Outside;
+
+    // the clipped polygon is convex, fan it back into triangles
+    Triangle3D::Vertex first(Divide(polygon[0].position), polygon[0].normal, polygon[0].textureCoordinates);
+    for (int i = 1; i + 1 < vertexCount; i++) {
+        std::array<Triangle3D::Vertex, 3> fan = {
+            first,
+            Triangle3D::Vertex(Divide(polygon[i].position), polygon[i].normal, polygon[i].textureCoordinates),
+            Triangle3D::Vertex(Divide(polygon[i + 1].position), polygon[i + 1].normal, polygon[i + 1].textureCoordinates)
+        };
+        output.emplace_back(fan);
+    }
+    return Result::Clipped;
+}
@@ -0,0 +1,82 @@
+#ifndef FRUSTUM_CLIPPER_H
+#define FRUSTUM_CLIPPER_H
+
+#include <vector>
+#include <stdint.h>
+#include "../../Core/Geometry/Polygon.h"
+#include "../../Core/Math/Matrix.h"
+#include "../../Core/Math/Vector.h"
+#include "../../Enums/Constants.h"
+#include "../../Engine/FrameArena/FrameArena.h"
+
+
+// Clips triangles in homogeneous clip space, before the perspective divide.
+// The camera looks down -z and the projection copies view z into w, so a point in front of the camera
+// has w < 0 and its distance along the view direction is -w.
+// Triangles entirely outside one frustum plane are rejected from their outcodes alone. Only the near and
+// far planes are clipped against routinely, x and y are only clipped against a guard band well outside the
+// screen, the rasterizers already clip to the window for free
+class FrustumClipper {
+    using Triangle3D = Polygon3D<float, 3>;
+    using Vertex = Vertex3<float>;
+    using Vector2 = Vector<float, 2>;
+    using Vector3 = Vector<float, 3>;
+    using Vector4 = Vector<float, 4>;
+
+    public:
+        enum class Result { Inside, Clipped, Outside };
+
+        // a triangle clipped by all 6 planes gains at most one corner per plane, Clip fans what is left into triangles
+        static constexpr int maxClippedVertices = 3 + 6;
+        static constexpr int maxClippedTriangles = maxClippedVertices - 2;
+
+        // pixels the guard band reaches past each window edge, keeps screen coordinates well inside fixed point range
+        static constexpr float guardBandPixels = 2048.0f;
+
+        FrustumClipper(float nearPlane = Constants::Projection::nearPlane, float farPlane = Constants::Projection::farPlane)
+            : nearPlane(nearPlane), farPlane(farPlane) {}
+
+        void SetPlanes(float newNearPlane, float newFarPlane) { nearPlane = newNearPlane; farPlane = newFarPlane; }
+        void SetViewport(float width, float height);
+        float GetNearPlane() const { return nearPlane; }
+        float GetFarPlane() const { return farPlane; }
+
+        // A corner position after the matrix, with its outcode and perspective divided position
+        struct TransformedVertex {
+            Vector4 position;
+            Vector3 divided;    // only meaningful in front of the camera
+            uint32_t outcode;
+        };
+
+        TransformedVertex Transform(const Vector3& position, const Matrix<float, 4, 4>& matrix) const;
+        // for positions some other pass already multiplied by the matrix
+        TransformedVertex FromClipSpace(const Vector4& position) const;
+
+        // Transforms the triangle by matrix and appends what is left of it, perspective divided like
+        // Polygon3D::CopyTransformedByMatrix4x4 does, to output
+        Result Clip(const Triangle3D& triangle, const Matrix<float, 4, 4>& matrix, FrameVector<Triangle3D>& output) const;
+        // Same with the corner positions already transformed, normals and texture coordinates still come from vertices
+        Result Clip(const Vertex* const vertices[3], const TransformedVertex* const corners[3], FrameVector<Triangle3D>& output) const;
+
+    private:
+        struct ClipVertex {
+            Vector4 position;
+            Vector3 normal;
+            Vector2 textureCoordinates;
+        };
+
+        enum Plane { Near, Far, Left, Right, Bottom, Top, GuardLeft, GuardRight, GuardBottom, GuardTop, PlaneCount };
+        static constexpr uint32_t frustumPlanes = (1 << Near) | (1 << Far) | (1 << Left) | (1 << Right) | (1 << Bottom) | (1 << Top);
+        static constexpr uint32_t clippingPlanes = (1 << Near) | (1 << Far) | (1 << GuardLeft) | (1 << GuardRight) | (1 << GuardBottom) | (1 << GuardTop);
+
+        float nearPlane, farPlane;
+        float guardBandX = 1.0f, guardBandY = 1.0f;     // guard band half extents in NDC
+
+        float Distance(const Vector4& position, int plane) const;     // >= 0 inside
+        uint32_t Outcode(const Vector4& position) const;
+        static Vector3 Divide(const Vector4& position);
+        static ClipVertex Interpolate(const ClipVertex& a, const ClipVertex& b, float t);
+};
+
+
+#endif
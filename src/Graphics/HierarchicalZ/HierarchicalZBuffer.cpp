@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <limits>
+#include "HierarchicalZBuffer.h"
+#include "../../Engine/Profiler/Profiler.h"
+
+
+void HierarchicalZBuffer::Build(const DepthBuffer& depthBuffer) {
+    PROFILE_FUNCTION();
+    int width = (depthBuffer.GetWidth() + baseBlockSize - 1) / baseBlockSize;
+    int height = (depthBuffer.GetHeight() + baseBlockSize - 1) / baseBlockSize;
+
+    // level sizes only change with the window, the vectors keep their memory between frames
+    size_t levelCount = 0;
+    for (int w = width, h = height; w > 0 && h > 0; w = (w + 1) / 2, h = (h + 1) / 2) {
+        levelCount++;
+        if (w == 1 && h == 1) break;
+    }
+    levels.resize(levelCount);
+
+    Level& base = levels[0];
+    base.width = width;
+    base.height = height;
+    base.depths.assign(size_t(width) * height, std::numeric_limits<float>::max());
+    for (int y = 0; y < depthBuffer.GetHeight(); y++) {
+        const float* row = depthBuffer.Row(y);
+        float* texels = base.depths.data() + size_t(y / baseBlockSize) * width;
+        for (int x = 0; x < depthBuffer.GetWidth(); x++) {
+            float& texel = texels[x / baseBlockSize];
+            texel = std::min(texel, row[x]);
+        }
+    }
+
+    for (size_t i = 1; i < levels.size(); i++) {
+        const Level& below = levels[i - 1];
+        Level& level = levels[i];
+        level.width = (below.width + 1) / 2;
+        level.height = (below.height + 1) / 2;
+        level.depths.resize(size_t(level.width) * level.height);
+
+        for (int y = 0; y < level.height; y++) {
+            int y0 = 2 * y, y1 = std::min(2 * y + 1, below.height - 1);
+            for (int x = 0; x < level.width; x++) {
+                int x0 = 2 * x, x1 = std::min(2 * x + 1, below.width - 1);
+                level.depths[size_t(y) * level.width + x] = std::min({ below.At(x0, y0), below.At(x1, y0), below.At(x0, y1), below.At(x1, y1) });
+            }
+        }
+    }
+}
+
+
+bool HierarchicalZBuffer::IsOccluded(int xMin, int yMin, int xMax, int yMax, float nearestDepth) const {
+    if (levels.empty()) return false;
+
+    // coarsest texels first get too blunt, so take the finest level the rectangle still fits in a few texels of
+    size_t levelIndex = 0;
+    int blockSize = baseBlockSize;
+    while (levelIndex + 1 < levels.size() &&
+           (xMax / blockSize - xMin / blockSize >= maxTestTexels || yMax / blockSize - yMin / blockSize >= maxTestTexels)) {
+        levelIndex++;
+        blockSize *= 2;
+    }
+
+    const Level& level = levels[levelIndex];
+    int texelXMin = std::max(xMin / blockSize, 0), texelXMax = std::min(xMax / blockSize, level.width - 1);
+    int texelYMin = std::max(yMin / blockSize, 0), texelYMax = std::min(yMax / blockSize, level.height - 1);
+
+    for (int y = texelYMin; y <= texelYMax; y++) {
+        for (int x = texelXMin; x <= texelXMax; x++) {
+            if (nearestDepth >= level.At(x, y)) return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef HIERARCHICAL_Z_BUFFER_H
+#define HIERARCHICAL_Z_BUFFER_H
+
+#include <vector>
+#include "../Framebuffer/DepthBuffer.h"
+
+
+// Depth pyramid for occlusion tests. Every texel keeps the farthest (lowest) depth of the pixels under it,
+// so anything nearer than a texel's value might still show and anything farther is certainly hidden.
+// Level 0 covers baseBlockSize x baseBlockSize pixels per texel, each level above halves the resolution
+class HierarchicalZBuffer {
+    public:
+        static constexpr int baseBlockSize = 4;
+
+        void Build(const DepthBuffer& depthBuffer);
+
+        // true when nearestDepth is behind everything already drawn in the inclusive pixel rectangle
+        bool IsOccluded(int xMin, int yMin, int xMax, int yMax, float nearestDepth) const;
+
+        bool IsEmpty() const { return levels.empty(); }
+
+    private:
+        // the coarsest level an occlusion test will read at most this many texels across
+        static constexpr int maxTestTexels = 4;
+
+        struct Level {
+            int width = 0, height = 0;
+            std::vector<float> depths;
+
+            float At(int x, int y) const { return depths[size_t(y) * width + x]; }
+        };
+
+        std::vector<Level> levels;
+};
+
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef RASTER_TYPES_H
+#define RASTER_TYPES_H
+
+#include <stdint.h>
+#include <array>
+#include "../../Core/Geometry/Polygon.h"
+
+
+// Inclusive pixel rectangle every raster operation is confined to
+struct ClipRect {
+    int xMin, yMin, xMax, yMax;
+};
+
+// Pixel counters for comparing painter's sort against depth testing; outlines aren't counted
+struct RasterStats {
+    uint64_t pixelsShaded = 0;      // color writes made by triangle fills
+    uint64_t pixelsRejected = 0;    // fill pixels that failed the depth test
+
+    void operator+=(const RasterStats &other) {
+        pixelsShaded += other.pixelsShaded;
+        pixelsRejected += other.pixelsRejected;
+    }
+};
+
+// Screen space triangle ready for rasterization, as produced by Renderer3D
+struct RasterTriangle {
+    Polygon2D<float, 3> screen;
+    std::array<float, 3> depths;
+    uint32_t fillColor, outlineColor;
+};
+
+
+#endif
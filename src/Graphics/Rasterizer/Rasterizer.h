@@ -0,0 +1,251 @@
+#ifndef RASTERIZER_H
+#define RASTERIZER_H
+
+#include <stdint.h>
+#include <array>
+#include <math.h>
+#include <algorithm>
+#include "../../Core/Math/Vector.h"
+#include "../../Core/Geometry/Polygon.h"
+#include "../Framebuffer/Framebuffer.h"
+#include "../Framebuffer/DepthBuffer.h"
+#include "RasterTypes.h"
+#include "TriangleKernels.h"
+
+
+// Software triangle/line rasterizer writing into a Framebuffer (and optionally a DepthBuffer) inside a clip rectangle.
+// Every pixel decision only depends on the primitive and the pixel itself, never on the clip rectangle,
+// so splitting the screen into tiles gives exactly the same image as one full screen pass
+class Rasterizer {
+    using Vector2 = Vector<float, 2>;
+    using Triangle2D = Polygon2D<float, 3>;
+
+    public:
+        // z = dzdx * x + (dzdy * y + offset); always evaluated in this order so every caller gets the same bits
+        struct DepthPlane {
+            float dzdx, dzdy, offset;
+
+            float RowBase(int y) const { return dzdy * y + offset; }
+            float At(int x, int y) const { return dzdx * x + RowBase(y); }
+        };
+
+        // Outlines sit exactly on their triangle's plane but can lose shared edge pixels to the neighbour's plane
+        static constexpr float outlineDepthBias = 1e-5f;
+
+        RasterStats stats;
+
+        Rasterizer(Framebuffer* framebuffer, DepthBuffer* depthBuffer, const ClipRect& clip)
+            : framebuffer(framebuffer), depthBuffer(depthBuffer), clip(clip) {}
+
+        void SetColor(uint32_t packedColor) { color = packedColor; }
+        void SetClipRect(const ClipRect& newClip) { clip = newClip; }
+        void SetDepthBuffer(DepthBuffer* newDepthBuffer) { depthBuffer = newDepthBuffer; }
+        const ClipRect& GetClipRect() const { return clip; }
+
+
+        // Calls spanFunction(y, xStart, xEnd) for every scanline of the triangle, spans already clipped and xStart <= xEnd
+        template <typename SpanFunction>
+        static void ScanTriangle(const Triangle2D& triangle, const ClipRect& clip, SpanFunction spanFunction) {
+            std::array<Vector2, 3> vertices = { triangle.vertices[0], triangle.vertices[1], triangle.vertices[2] };
+            std::sort(vertices.begin(), vertices.end(), [](const Vector2& a, const Vector2& b) {
+                return a[1] < b[1];
+            });
+
+            const Vector2 &v1 = vertices[0], &v2 = vertices[1], &v3 = vertices[2];
+            if (v1[1] == v3[1]) return; // no height, no scanlines
+            if (v2[1] == v3[1]) {
+                ScanFlatBottomTriangle(v1, v2, v3, clip, spanFunction);
+            } else if (v1[1] == v2[1]) {
+                ScanFlatTopTriangle(v1, v2, v3, clip, spanFunction);
+            } else {
+                float t = (v2[1] - v1[1]) / (v3[1] - v1[1]);
+                Vector2 v4 = v1 + (v3 - v1) * t;
+                ScanFlatBottomTriangle(v1, v2, v4, clip, spanFunction);
+                ScanFlatTopTriangle(v2, v4, v3, clip, spanFunction);
+            }
+        }
+
+        // plane through the three (x, y, z) corners, false for triangles with no screen area
+        static bool FindDepthPlane(const Triangle2D& triangle, const std::array<float, 3>& depths, DepthPlane& plane) {
+            float ax = triangle.vertices[1][0] - triangle.vertices[0][0], ay = triangle.vertices[1][1] - triangle.vertices[0][1];
+            float bx = triangle.vertices[2][0] - triangle.vertices[0][0], by = triangle.vertices[2][1] - triangle.vertices[0][1];
+            float az = depths[1] - depths[0], bz = depths[2] - depths[0];
+
+            float area = ax * by - ay * bx;
+            if (std::abs(area) < 1e-12f) return false;
+
+            plane.dzdx = (az * by - ay * bz) / area;
+            plane.dzdy = (ax * bz - az * bx) / area;
+            plane.offset = depths[0] - plane.dzdx * triangle.vertices[0][0] - plane.dzdy * triangle.vertices[0][1];
+            return true;
+        }
+
+
+        // Framebuffer fills go through the SIMD edge function kernels, scanlines are only the fallback
+        // for corners too far off-screen for fixed point
+        void FillTriangle(const Triangle2D& triangle) {
+            TriangleKernels::FillParameters params = MakeFillParameters(triangle);
+            if (TriangleKernels::FillTriangle(params, stats)) return;
+
+            ScanTriangle(triangle, clip, [this](int y, int xStart, int xEnd) {
+                std::fill_n(framebuffer->Row(y) + xStart, xEnd - xStart + 1, color);
+                stats.pixelsShaded += xEnd - xStart + 1;
+            });
+        }
+
+        // Early depth test: color is only written for pixels whose depth passed
+        void FillTriangle(const Triangle2D& triangle, const std::array<float, 3>& depths) {
+            DepthPlane plane;
+            if (!FindDepthPlane(triangle, depths, plane)) return;
+
+            TriangleKernels::FillParameters params = MakeFillParameters(triangle);
+            params.depthPixels = depthBuffer->Row(0);
+            params.depthStride = depthBuffer->GetStride();
+            params.dzdx = plane.dzdx;
+            params.dzdy = plane.dzdy;
+            params.depthOffset = plane.offset;
+            if (TriangleKernels::FillTriangle(params, stats)) return;
+
+            FillTriangle(triangle, depths, [this](int y, int xStart, int xEnd) {
+                std::fill_n(framebuffer->Row(y) + xStart, xEnd - xStart + 1, color);
+            });
+        }
+
+        // Depth tested fill that hands every visible run runFunction(y, xStart, xEnd) instead of writing color itself
+        template <typename RunFunction>
+        void FillTriangle(const Triangle2D& triangle, const std::array<float, 3>& depths, RunFunction runFunction) {
+            DepthPlane plane;
+            if (!FindDepthPlane(triangle, depths, plane)) return;
+
+            ScanTriangle(triangle, clip, [&](int y, int xStart, int xEnd) {
+                float* depthRow = depthBuffer->Row(y);
+                float rowBase = plane.RowBase(y);
+                int runStart = -1;
+
+                for (int x = xStart; x <= xEnd; x++) {
+                    float z = plane.dzdx * x + rowBase;
+                    if (z >= depthRow[x]) {
+                        depthRow[x] = z;
+                        stats.pixelsShaded++;
+                        if (runStart < 0) runStart = x;
+                        continue;
+                    }
+                    stats.pixelsRejected++;
+                    if (runStart >= 0) runFunction(y, runStart, x - 1);
+                    runStart = -1;
+                }
+                if (runStart >= 0) runFunction(y, runStart, xEnd);
+            });
+        }
+
+        void DrawTriangle(const Triangle2D& triangle) {
+            for (int i = 0; i < 3; i++) {
+                const Vector2& start = triangle.vertices[i];
+                const Vector2& end = triangle.vertices[(i + 1) % 3];
+                if (!EdgeMayTouchClip(start, end)) continue;
+                framebuffer->ForEachLinePixel(start[0], start[1], end[0], end[1], [this](int x, int y) {
+                    if (Contains(x, y)) framebuffer->Row(y)[x] = color;
+                });
+            }
+        }
+
+        // Depth tested outline, hidden edges stay hidden
+        void DrawTriangle(const Triangle2D& triangle, const std::array<float, 3>& depths) {
+            DrawTriangle(triangle, depths, [this](int x, int y, bool visible) {
+                if (visible) framebuffer->Row(y)[x] = color;
+            });
+        }
+
+        // Depth tested outline reporting pixelFunction(x, y, visible) for every pixel along the edges
+        template <typename PixelFunction>
+        void DrawTriangle(const Triangle2D& triangle, const std::array<float, 3>& depths, PixelFunction pixelFunction) {
+            DepthPlane plane;
+            if (!FindDepthPlane(triangle, depths, plane)) return;
+
+            for (int i = 0; i < 3; i++) {
+                const Vector2& start = triangle.vertices[i];
+                const Vector2& end = triangle.vertices[(i + 1) % 3];
+                if (!EdgeMayTouchClip(start, end)) continue;
+                framebuffer->ForEachLinePixel(start[0], start[1], end[0], end[1], [&](int x, int y) {
+                    if (!Contains(x, y)) return;
+                    float z = plane.At(x, y);
+                    float& storedDepth = depthBuffer->Row(y)[x];
+                    bool visible = z + outlineDepthBias >= storedDepth;
+                    if (visible) storedDepth = std::max(storedDepth, z);
+                    pixelFunction(x, y, visible);
+                });
+            }
+        }
+
+    private:
+        Framebuffer* framebuffer;
+        DepthBuffer* depthBuffer;
+        ClipRect clip;
+        uint32_t color = 0;
+
+        TriangleKernels::FillParameters MakeFillParameters(const Triangle2D& triangle) const {
+            TriangleKernels::FillParameters params = {};
+            for (int i = 0; i < 3; i++) {
+                params.x[i] = triangle.vertices[i][0];
+                params.y[i] = triangle.vertices[i][1];
+            }
+            params.color = color;
+            params.colorPixels = framebuffer->Row(0);
+            params.colorStride = framebuffer->GetStride();
+            params.clip = clip;
+            return params;
+        }
+
+        bool Contains(int x, int y) const {
+            return x >= clip.xMin && x <= clip.xMax && y >= clip.yMin && y <= clip.yMax;
+        }
+
+        // cheap bounding box reject so tiles don't walk edges that can't reach them; a pixel of slack covers rounding
+        bool EdgeMayTouchClip(const Vector2& start, const Vector2& end) const {
+            return std::max(start[0], end[0]) >= clip.xMin - 1 && std::min(start[0], end[0]) <= clip.xMax + 1 &&
+                   std::max(start[1], end[1]) >= clip.yMin - 1 && std::min(start[1], end[1]) <= clip.yMax + 1;
+        }
+
+        // Each scanline's edges are computed from the vertices directly instead of stepping from the previous line,
+        // so a span comes out the same whichever line the clip rectangle starts at
+        template <typename SpanFunction>
+        static void EmitSpan(int y, float x1, float x2, const ClipRect& clip, SpanFunction& spanFunction) {
+            int xStart = static_cast<int>(std::round(x1));
+            int xEnd = static_cast<int>(std::round(x2));
+            if (xStart > xEnd) std::swap(xStart, xEnd);
+            xStart = std::max(xStart, clip.xMin);
+            xEnd = std::min(xEnd, clip.xMax);
+            if (xStart <= xEnd) spanFunction(y, xStart, xEnd);
+        }
+
+        // v1 and v2 on top, v3 below
+        template <typename SpanFunction>
+        static void ScanFlatTopTriangle(const Vector2& v1, const Vector2& v2, const Vector2& v3, const ClipRect& clip, SpanFunction& spanFunction) {
+            float m1 = (v3[0] - v1[0]) / (v3[1] - v1[1]);
+            float m2 = (v3[0] - v2[0]) / (v3[1] - v2[1]);
+
+            int yStart = std::max(static_cast<int>(std::ceil(v1[1])), clip.yMin);
+            int yEnd = std::min(static_cast<int>(std::floor(v3[1])), clip.yMax);
+
+            for (int y = yStart; y <= yEnd; y++) {
+                EmitSpan(y, v1[0] + (y - v1[1]) * m1, v2[0] + (y - v2[1]) * m2, clip, spanFunction);
+            }
+        }
+
+        // v1 on top, v2 and v3 below
+        template <typename SpanFunction>
+        static void ScanFlatBottomTriangle(const Vector2& v1, const Vector2& v2, const Vector2& v3, const ClipRect& clip, SpanFunction& spanFunction) {
+            float m1 = (v2[0] - v1[0]) / (v2[1] - v1[1]);
+            float m2 = (v3[0] - v1[0]) / (v3[1] - v1[1]);
+
+            int yStart = std::max(static_cast<int>(std::ceil(v1[1])), clip.yMin);
+            int yEnd = std::min(static_cast<int>(std::floor(v2[1])), clip.yMax);
+
+            for (int y = yStart; y <= yEnd; y++) {
+                EmitSpan(y, v1[0] + (y - v1[1]) * m1, v1[0] + (y - v1[1]) * m2, clip, spanFunction);
+            }
+        }
+};
+
+
+#endif
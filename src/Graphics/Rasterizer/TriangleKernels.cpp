@@ -0,0 +1,377 @@
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include "TriangleKernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TRIANGLE_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+// lets the AVX2 kernel live next to the baseline code without compiling the whole engine with -mavx2
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+
+namespace TriangleKernels {
+namespace {
+
+    constexpr int subpixelBits = 4;
+    constexpr int64_t subpixelSteps = int64_t(1) << subpixelBits;
+
+    // corners further out than this would overflow the 64 bit setup
+    constexpr float maxCoordinate = float(1 << 20);
+
+    // the SIMD loops step edge functions in 32 bit lanes
+    constexpr int64_t maxInt32EdgeValue = (int64_t(1) << 31) - 1;
+
+    enum class SetupResult { Empty, Ready, OutOfRange };
+
+    struct EdgeSetup {
+        int64_t stepX[3], stepY[3];     // change of each edge function per pixel in x and y
+        int64_t start[3];               // edge functions at (xStart, yStart), fill rule bias included
+        int xStart, xEnd, yStart, yEnd; // pixels to visit, xStart pulled back to a block boundary when the clip allows it
+        bool fitsInt32;                 // whole neighbourhood of the triangle fits 32 bit lanes
+    };
+
+
+    int64_t FloorDivide(int64_t value, int64_t divisor) {
+        return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+    }
+
+    int64_t CeilDivide(int64_t value, int64_t divisor) {
+        return -FloorDivide(-value, divisor);
+    }
+
+    int CountBits(unsigned mask) {
+        int count = 0;
+        for (; mask; mask &= mask - 1) count++;
+        return count;
+    }
+
+
+    SetupResult SetupEdges(const FillParameters& params, int blockWidth, EdgeSetup& setup) {
+        int64_t x[3], y[3];
+        for (int i = 0; i < 3; i++) {
+            // written this way round so NaN lands in the fallback too
+            if (!(std::abs(params.x[i]) <= maxCoordinate && std::abs(params.y[i]) <= maxCoordinate)) return SetupResult::OutOfRange;
+            x[i] = llroundf(params.x[i] * subpixelSteps);
+            y[i] = llroundf(params.y[i] * subpixelSteps);
+        }
+
+        int64_t area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+        if (area == 0) return SetupResult::Empty;
+        if (area < 0) {
+            std::swap(x[1], x[2]);
+            std::swap(y[1], y[2]);
+        }
+
+        // pixels whose integer sample point lies inside the snapped bounding box
+        int64_t boxMinX = CeilDivide(std::min({x[0], x[1], x[2]}), subpixelSteps);
+        int64_t boxMaxX = FloorDivide(std::max({x[0], x[1], x[2]}), subpixelSteps);
+        int64_t boxMinY = CeilDivide(std::min({y[0], y[1], y[2]}), subpixelSteps);
+        int64_t boxMaxY = FloorDivide(std::max({y[0], y[1], y[2]}), subpixelSteps);
+
+        const ClipRect& clip = params.clip;
+        int64_t xMin = std::max<int64_t>(boxMinX, clip.xMin), xMax = std::min<int64_t>(boxMaxX, clip.xMax);
+        int64_t yMin = std::max<int64_t>(boxMinY, clip.yMin), yMax = std::min<int64_t>(boxMaxY, clip.yMax);
+        if (xMin > xMax || yMin > yMax) return SetupResult::Empty;
+
+        setup.xStart = std::max(static_cast<int>(FloorDivide(xMin, blockWidth) * blockWidth), clip.xMin);
+        setup.xEnd = static_cast<int>(xMax);
+        setup.yStart = static_cast<int>(yMin);
+        setup.yEnd = static_cast<int>(yMax);
+
+        // Decided from the unclipped box only, so every screen tile takes the same path for the same triangle.
+        // Covers the block padding on both sides and the step past the last block and row
+        int64_t reachMinX = boxMinX - blockWidth, reachMaxX = boxMaxX + 2 * blockWidth;
+        int64_t reachMinY = boxMinY, reachMaxY = boxMaxY + 1;
+        setup.fitsInt32 = true;
+
+        for (int i = 0; i < 3; i++) {
+            int a = i, b = (i + 1) % 3;
+            int64_t dx = x[b] - x[a], dy = y[b] - y[a];
+
+            // top-left rule: pixels exactly on an edge belong to the triangle only for top and left edges
+            bool topLeft = dy < 0 || (dy == 0 && dx > 0);
+            int64_t bias = topLeft ? 0 : -1;
+
+            auto edgeAt = [&](int64_t pixelX, int64_t pixelY) {
+                return dx * (pixelY * subpixelSteps - y[a]) - dy * (pixelX * subpixelSteps - x[a]) + bias;
+            };
+
+            setup.stepX[i] = -dy * subpixelSteps;
+            setup.stepY[i] = dx * subpixelSteps;
+            setup.start[i] = edgeAt(setup.xStart, setup.yStart);
+
+            for (int64_t cornerX : { reachMinX, reachMaxX }) {
+                for (int64_t cornerY : { reachMinY, reachMaxY }) {
+                    int64_t value = edgeAt(cornerX, cornerY);
+                    if (value > maxInt32EdgeValue || value < -maxInt32EdgeValue) setup.fitsInt32 = false;
+                }
+            }
+        }
+        return SetupResult::Ready;
+    }
+
+
+    void FillScalar(const FillParameters& params, const EdgeSetup& setup, RasterStats& stats) {
+        int64_t row[3] = { setup.start[0], setup.start[1], setup.start[2] };
+
+        for (int y = setup.yStart; y <= setup.yEnd; y++) {
+            int64_t edge[3] = { row[0], row[1], row[2] };
+            uint32_t* colorRow = params.colorPixels + size_t(y) * params.colorStride;
+            float* depthRow = params.depthPixels ? params.depthPixels + size_t(y) * params.depthStride : nullptr;
+            float rowBase = params.dzdy * y + params.depthOffset;
+
+            for (int x = setup.xStart; x <= setup.xEnd; x++) {
+                if ((edge[0] | edge[1] | edge[2]) >= 0) {
+                    if (!depthRow) {
+                        colorRow[x] = params.color;
+                        stats.pixelsShaded++;
+                    }
+                    else {
+                        float z = params.dzdx * float(x) + rowBase;
+                        if (z >= depthRow[x]) {
+                            depthRow[x] = z;
+                            colorRow[x] = params.color;
+                            stats.pixelsShaded++;
+                        }
+                        else stats.pixelsRejected++;
+                    }
+                }
+                for (int i = 0; i < 3; i++) edge[i] += setup.stepX[i];
+            }
+            for (int i = 0; i < 3; i++) row[i] += setup.stepY[i];
+        }
+    }
+
+
+#ifdef TRIANGLE_KERNELS_X86
+
+    // Blocks hanging over the clip rectangle go through these lane by lane, so no store ever touches
+    // a pixel another tile's worker may be writing
+    template <int Lanes>
+    struct PartialBlock {
+        alignas(32) uint32_t colors[Lanes];
+        alignas(32) float depths[Lanes];
+        int laneCount = Lanes;
+
+        void Load(const uint32_t* colorRow, const float* depthRow, int x, int clipMaxX) {
+            laneCount = std::min(clipMaxX - x + 1, Lanes);
+            for (int lane = 0; lane < Lanes; lane++) {
+                colors[lane] = lane < laneCount ? colorRow[x + lane] : 0;
+                depths[lane] = lane < laneCount && depthRow ? depthRow[x + lane] : 0.0f;
+            }
+        }
+
+        void Store(uint32_t* colorRow, float* depthRow, int x) const {
+            for (int lane = 0; lane < laneCount; lane++) {
+                colorRow[x + lane] = colors[lane];
+                if (depthRow) depthRow[x + lane] = depths[lane];
+            }
+        }
+    };
+
+
+    void FillSSE2(const FillParameters& params, const EdgeSetup& setup, RasterStats& stats) {
+        constexpr int lanes = 4;
+        __m128i laneEdge[3], blockStep[3];
+        for (int i = 0; i < 3; i++) {
+            int32_t step = static_cast<int32_t>(setup.stepX[i]);
+            laneEdge[i] = _mm_setr_epi32(0, step, 2 * step, 3 * step);
+            blockStep[i] = _mm_set1_epi32(step * lanes);
+        }
+        const __m128i minusOne = _mm_set1_epi32(-1);
+        const __m128i laneIndex = _mm_setr_epi32(0, 1, 2, 3);
+        const __m128i color = _mm_set1_epi32(static_cast<int32_t>(params.color));
+        const __m128 dzdx = _mm_set1_ps(params.dzdx);
+        const __m128 laneX = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+        int64_t row[3] = { setup.start[0], setup.start[1], setup.start[2] };
+
+        for (int y = setup.yStart; y <= setup.yEnd; y++) {
+            __m128i edge[3];
+            for (int i = 0; i < 3; i++) edge[i] = _mm_add_epi32(_mm_set1_epi32(static_cast<int32_t>(row[i])), laneEdge[i]);
+
+            uint32_t* colorRow = params.colorPixels + size_t(y) * params.colorStride;
+            float* depthRow = params.depthPixels ? params.depthPixels + size_t(y) * params.depthStride : nullptr;
+            const __m128 rowBase = _mm_set1_ps(params.dzdy * y + params.depthOffset);
+
+            for (int x = setup.xStart; x <= setup.xEnd; x += lanes) {
+                __m128i covered = _mm_cmpgt_epi32(_mm_or_si128(_mm_or_si128(edge[0], edge[1]), edge[2]), minusOne);
+                for (int i = 0; i < 3; i++) edge[i] = _mm_add_epi32(edge[i], blockStep[i]);
+
+                bool fullBlock = x + lanes - 1 <= params.clip.xMax;
+                if (!fullBlock) {
+                    covered = _mm_and_si128(covered, _mm_cmpgt_epi32(_mm_set1_epi32(params.clip.xMax - x + 1), laneIndex));
+                }
+                unsigned coverMask = _mm_movemask_ps(_mm_castsi128_ps(covered));
+                if (!coverMask) continue;
+
+                PartialBlock<lanes> partial;
+                if (!fullBlock) partial.Load(colorRow, depthRow, x, params.clip.xMax);
+
+                __m128i oldColor = fullBlock ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(colorRow + x))
+                                             : _mm_load_si128(reinterpret_cast<const __m128i*>(partial.colors));
+                __m128i write = covered;
+
+                if (depthRow) {
+                    __m128 oldDepth = fullBlock ? _mm_loadu_ps(depthRow + x) : _mm_load_ps(partial.depths);
+                    __m128 z = _mm_add_ps(_mm_mul_ps(dzdx, _mm_add_ps(_mm_set1_ps(float(x)), laneX)), rowBase);
+                    __m128 pass = _mm_and_ps(_mm_castsi128_ps(covered), _mm_cmpge_ps(z, oldDepth));
+                    unsigned passMask = _mm_movemask_ps(pass);
+                    stats.pixelsRejected += CountBits(coverMask & ~passMask);
+                    if (!passMask) continue;
+
+                    __m128 newDepth = _mm_or_ps(_mm_and_ps(pass, z), _mm_andnot_ps(pass, oldDepth));
+                    if (fullBlock) _mm_storeu_ps(depthRow + x, newDepth);
+                    else _mm_store_ps(partial.depths, newDepth);
+                    write = _mm_castps_si128(pass);
+                    coverMask = passMask;
+                }
+
+                __m128i newColor = _mm_or_si128(_mm_and_si128(write, color), _mm_andnot_si128(write, oldColor));
+                stats.pixelsShaded += CountBits(coverMask);
+                if (fullBlock) {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(colorRow + x), newColor);
+                    continue;
+                }
+                _mm_store_si128(reinterpret_cast<__m128i*>(partial.colors), newColor);
+                partial.Store(colorRow, depthRow, x);
+            }
+            for (int i = 0; i < 3; i++) row[i] += setup.stepY[i];
+        }
+    }
+
+
+    TARGET_AVX2 void FillAVX2(const FillParameters& params, const EdgeSetup& setup, RasterStats& stats) {
+        constexpr int lanes = 8;
+        __m256i laneEdge[3], blockStep[3];
+        for (int i = 0; i < 3; i++) {
+            int32_t step = static_cast<int32_t>(setup.stepX[i]);
+            laneEdge[i] = _mm256_setr_epi32(0, step, 2 * step, 3 * step, 4 * step, 5 * step, 6 * step, 7 * step);
+            blockStep[i] = _mm256_set1_epi32(step * lanes);
+        }
+        const __m256i minusOne = _mm256_set1_epi32(-1);
+        const __m256i laneIndex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256i color = _mm256_set1_epi32(static_cast<int32_t>(params.color));
+        const __m256 dzdx = _mm256_set1_ps(params.dzdx);
+        const __m256 laneX = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+
+        int64_t row[3] = { setup.start[0], setup.start[1], setup.start[2] };
+
+        for (int y = setup.yStart; y <= setup.yEnd; y++) {
+            __m256i edge[3];
+            for (int i = 0; i < 3; i++) edge[i] = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int32_t>(row[i])), laneEdge[i]);
+
+            uint32_t* colorRow = params.colorPixels + size_t(y) * params.colorStride;
+            float* depthRow = params.depthPixels ? params.depthPixels + size_t(y) * params.depthStride : nullptr;
+            const __m256 rowBase = _mm256_set1_ps(params.dzdy * y + params.depthOffset);
+
+            for (int x = setup.xStart; x <= setup.xEnd; x += lanes) {
+                __m256i covered = _mm256_cmpgt_epi32(_mm256_or_si256(_mm256_or_si256(edge[0], edge[1]), edge[2]), minusOne);
+                for (int i = 0; i < 3; i++) edge[i] = _mm256_add_epi32(edge[i], blockStep[i]);
+
+                bool fullBlock = x + lanes - 1 <= params.clip.xMax;
+                if (!fullBlock) {
+                    covered = _mm256_and_si256(covered, _mm256_cmpgt_epi32(_mm256_set1_epi32(params.clip.xMax - x + 1), laneIndex));
+                }
+                unsigned coverMask = _mm256_movemask_ps(_mm256_castsi256_ps(covered));
+                if (!coverMask) continue;
+
+                PartialBlock<lanes> partial;
+                if (!fullBlock) partial.Load(colorRow, depthRow, x, params.clip.xMax);
+
+                __m256i oldColor = fullBlock ? _mm256_loadu_si256(reinterpret_cast<const __m256i*>(colorRow + x))
+                                             : _mm256_load_si256(reinterpret_cast<const __m256i*>(partial.colors));
+                __m256i write = covered;
+
+                if (depthRow) {
+                    __m256 oldDepth = fullBlock ? _mm256_loadu_ps(depthRow + x) : _mm256_load_ps(partial.depths);
+                    __m256 z = _mm256_add_ps(_mm256_mul_ps(dzdx, _mm256_add_ps(_mm256_set1_ps(float(x)), laneX)), rowBase);
+                    __m256 pass = _mm256_and_ps(_mm256_castsi256_ps(covered), _mm256_cmp_ps(z, oldDepth, _CMP_GE_OQ));
+                    unsigned passMask = _mm256_movemask_ps(pass);
+                    stats.pixelsRejected += CountBits(coverMask & ~passMask);
+                    if (!passMask) continue;
+
+                    __m256 newDepth = _mm256_blendv_ps(oldDepth, z, pass);
+                    if (fullBlock) _mm256_storeu_ps(depthRow + x, newDepth);
+                    else _mm256_store_ps(partial.depths, newDepth);
+                    write = _mm256_castps_si256(pass);
+                    coverMask = passMask;
+                }
+
+                __m256i newColor = _mm256_blendv_epi8(oldColor, color, write);
+                stats.pixelsShaded += CountBits(coverMask);
+                if (fullBlock) {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(colorRow + x), newColor);
+                    continue;
+                }
+                _mm256_store_si256(reinterpret_cast<__m256i*>(partial.colors), newColor);
+                partial.Store(colorRow, depthRow, x);
+            }
+            for (int i = 0; i < 3; i++) row[i] += setup.stepY[i];
+        }
+    }
+
+#endif
+
+
+    InstructionSet DetectInstructionSet() {
+#ifdef TRIANGLE_KERNELS_X86
+        if (SDL_HasAVX2()) return InstructionSet::AVX2;
+        if (SDL_HasSSE2()) return InstructionSet::SSE2;
+#endif
+        return InstructionSet::Scalar;
+    }
+
+    const InstructionSet supportedInstructionSet = DetectInstructionSet();
+    InstructionSet activeInstructionSet = supportedInstructionSet;
+}
+
+
+bool FillTriangle(const FillParameters& params, RasterStats& stats) {
+    InstructionSet instructionSet = activeInstructionSet;
+    int blockWidth = instructionSet == InstructionSet::AVX2 ? 8 : instructionSet == InstructionSet::SSE2 ? 4 : 1;
+
+    EdgeSetup setup;
+    SetupResult result = SetupEdges(params, blockWidth, setup);
+    if (result == SetupResult::OutOfRange) return false;
+    if (result == SetupResult::Empty) return true;
+
+#ifdef TRIANGLE_KERNELS_X86
+    if (setup.fitsInt32 && instructionSet == InstructionSet::AVX2) {
+        FillAVX2(params, setup, stats);
+        return true;
+    }
+    if (setup.fitsInt32 && instructionSet == InstructionSet::SSE2) {
+        FillSSE2(params, setup, stats);
+        return true;
+    }
+#endif
+    FillScalar(params, setup, stats);
+    return true;
+}
+
+InstructionSet GetInstructionSet() {
+    return activeInstructionSet;
+}
+
+void SetInstructionSet(InstructionSet instructionSet) {
+    activeInstructionSet = std::min(instructionSet, supportedInstructionSet);
+}
+
+const char* GetInstructionSetName(InstructionSet instructionSet) {
+    switch (instructionSet) {
+        case InstructionSet::AVX2: return "AVX2";
+        case InstructionSet::SSE2: return "SSE2";
+        default: return "scalar";
+    }
+}
+
+}
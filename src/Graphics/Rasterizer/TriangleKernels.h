@@ -0,0 +1,40 @@
+#ifndef TRIANGLE_KERNELS_H
+#define TRIANGLE_KERNELS_H
+
+#include <stdint.h>
+#include "RasterTypes.h"
+
+
+// Half-space (edge function) triangle fill.
+// Vertices are snapped to 28.4 fixed point and edge functions are stepped in integers, pixel samples sit on
+// integer coordinates (the same convention the Bresenham lines use) and a top-left fill rule makes triangles
+// sharing an edge cover every pixel along it exactly once.
+// The inner loop tests and shades 8 pixels at a time with AVX2 or 4 with SSE2, picked at runtime from the CPU
+namespace TriangleKernels {
+
+    enum class InstructionSet { Scalar, SSE2, AVX2 };
+
+    struct FillParameters {
+        float x[3], y[3];               // screen space corners
+        uint32_t color;
+
+        uint32_t* colorPixels;          // framebuffer rows
+        int colorStride;                // in pixels
+        float* depthPixels;             // nullptr disables the depth test
+        int depthStride;
+        float dzdx, dzdy, depthOffset;  // depth plane, z = dzdx * x + (dzdy * y + depthOffset)
+
+        ClipRect clip;
+    };
+
+    // Fills the triangle inside params.clip. Returns false when the corners are too far off-screen
+    // for fixed point, the caller then has to fall back to another rasterizer
+    bool FillTriangle(const FillParameters& params, RasterStats& stats);
+
+    InstructionSet GetInstructionSet();
+    // for comparing kernels, anything the CPU doesn't support is lowered to the best one it does
+    void SetInstructionSet(InstructionSet instructionSet);
+    const char* GetInstructionSetName(InstructionSet instructionSet);
+}
+
+#endif
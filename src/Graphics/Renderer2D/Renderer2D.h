@@ -9,6 +9,10 @@
 #include <algorithm>
 #include "../../Core/Math/Vector.h"
 #include "../../Core/Geometry/Polygon.h"
+#include "../Framebuffer/Framebuffer.h"
+#include "../Framebuffer/DepthBuffer.h"
+#include "../Rasterizer/Rasterizer.h"
+#include "../../Engine/Profiler/Profiler.h"
 
 
 class Renderer2D {
@@ -16,8 +20,64 @@ class Renderer2D {
     using Color4 = Vector<uint8_t, 4>;
     using Triangle2D = Polygon2D<float, 3>;
     using Vector2 = Vector<float, 2>;
+    public:
+        // SDL issues one driver call per primitive, Framebuffer rasterizes into memory and uploads once per frame
+        enum class Backend { SDL, Framebuffer };
+
     private:
         SDL_Renderer* renderer;
+        SDL_Texture* framebufferTexture = nullptr;
+        Framebuffer framebuffer;
+        Backend backend;
+        Color4 drawColor = Color4(0, 0, 0, 255);
+        uint32_t packedDrawColor = Framebuffer::PackColor(0, 0, 0, 255);
+
+        DepthBuffer depthBuffer;
+        Rasterizer rasterizer;      // full window clip, used by the framebuffer backend
+
+        // SDL backend primitives waiting for Flush(), all in the current draw color.
+        // Lines that start where the previous one ended extend the same strip
+        std::vector<SDL_Point> queuedPoints;
+        std::vector<SDL_FPoint> queuedLinePoints;
+        std::vector<int> queuedStripLengths;
+        std::vector<SDL_Rect> queuedFillRects;
+        std::vector<SDL_FRect> queuedOutlineRects;
+
+        void QueueLine(float x1, float y1, float x2, float y2) {
+            bool continuesStrip = !queuedStripLengths.empty() && queuedLinePoints.back().x == x1 && queuedLinePoints.back().y == y1;
+            if (!continuesStrip) {
+                queuedLinePoints.push_back({ x1, y1 });
+                queuedStripLengths.push_back(1);
+            }
+            queuedLinePoints.push_back({ x2, y2 });
+            queuedStripLengths.back()++;
+        }
+
+        void DiscardQueued() {
+            queuedPoints.clear();
+            queuedLinePoints.clear();
+            queuedStripLengths.clear();
+            queuedFillRects.clear();
+            queuedOutlineRects.clear();
+        }
+
+        void CreateFramebufferTexture() {
+            if (framebufferTexture) SDL_DestroyTexture(framebufferTexture);
+            framebufferTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                                   framebuffer.GetWidth(), framebuffer.GetHeight());
+        }
+
+        ClipRect GetWindowClipRect() const {
+            return { 0, 0, framebuffer.GetWidth() - 1, framebuffer.GetHeight() - 1 };
+        }
+
+        template <typename ComponentType>
+        static Triangle2D ToTriangle2D(const Polygon2D<ComponentType, 3>& triangle) {
+            Triangle2D output;
+            for (int i = 0; i < 3; i++) output.vertices[i] = Vector2(triangle.vertices[i][0], triangle.vertices[i][1]);
+            return output;
+        }
+
         void PutCirclePoints(int xc, int yc, int x, int y){
             DrawPoint(xc+x, yc+y);
             DrawPoint(xc-x, yc+y);
@@ -29,77 +89,127 @@ class Renderer2D {
             DrawPoint(xc-y, yc-x);
         }
 
-        void FillFlatTopTriangle(const Vector2& v1, const Vector2& v2, const Vector2& v3) {
-            float m1 = (v3[0] - v1[0]) / (v3[1] - v1[1]);
-            float m2 = (v3[0] - v2[0]) / (v3[1] - v2[1]);
+    public:
+        Renderer2D(SDL_Renderer* sdlRenderer, int width, int height, Backend backend = Backend::Framebuffer) 
+            : renderer(sdlRenderer), framebuffer(width, height), backend(backend),
+              depthBuffer(0, 0), rasterizer(&framebuffer, &depthBuffer, GetWindowClipRect()) {
+            rasterizer.SetColor(packedDrawColor);
+            if (backend == Backend::Framebuffer) CreateFramebufferTexture();
+            queuedFillRects.reserve(height);    // a filled triangle queues at most one span per row
+        }
+
+        ~Renderer2D() {
+            if (framebufferTexture) SDL_DestroyTexture(framebufferTexture);
+        }
+        
+        // Prevent copying
+        Renderer2D(const Renderer2D&) = delete;
+        Renderer2D& operator=(const Renderer2D&) = delete;
+
 
-            int yStart = static_cast<int>(std::ceil(v1[1]));
-            int yEnd = static_cast<int>(std::floor(v3[1]));
+        Backend GetBackend() const { return backend; }
 
-            float x1 = v1[0] + (yStart - v1[1]) * m1;
-            float x2 = v2[0] + (yStart - v2[1]) * m2;
+        void SetBackend(Backend newBackend) {
+            Flush();
+            backend = newBackend;
+            if (backend == Backend::Framebuffer && !framebufferTexture) CreateFramebufferTexture();
+            if (backend == Backend::SDL) SetDrawColor(drawColor); // SDL didn't see color changes while we were drawing to memory
+        }
 
-            for (int y = yStart; y <= yEnd; y++) {
-                int startX = static_cast<int>(std::round(x1));
-                int endX = static_cast<int>(std::round(x2));
-                if (startX > endX) std::swap(startX, endX);
-                
-                DrawLine(startX, y, endX, y);
-                x1 += m1;
-                x2 += m2;
-            }
+        void Resize(int width, int height) {
+            framebuffer.Resize(width, height);
+            if (depthBuffer.GetWidth() > 0) depthBuffer.Resize(width, height);
+            rasterizer.SetClipRect(GetWindowClipRect());
+            if (framebufferTexture) CreateFramebufferTexture();
+            queuedFillRects.reserve(height);
         }
 
-        void FillFlatBottomTriangle(const Vector2& v1, const Vector2& v2, const Vector2& v3) {
-            float m1 = (v2[0] - v1[0]) / (v2[1] - v1[1]);
-            float m2 = (v3[0] - v1[0]) / (v3[1] - v1[1]);
+        // Room for this many queued line segments, so outlines queued between flushes don't grow the queues mid-frame
+        void ReserveLines(size_t segmentCount) {
+            queuedLinePoints.reserve(segmentCount * 2);
+            queuedStripLengths.reserve(segmentCount);
+        }
 
-            int yStart = static_cast<int>(std::ceil(v1[1]));
-            int yEnd = static_cast<int>(std::floor(v2[1]));
+        Framebuffer& GetFramebuffer() { return framebuffer; }
+        DepthBuffer& GetDepthBuffer() { return depthBuffer; }
+        uint32_t GetPackedDrawColor() const { return packedDrawColor; }
 
-            float x1 = v1[0] + (yStart - v1[1]) * m1;
-            float x2 = v1[0] + (yStart - v1[1]) * m2;
+        const RasterStats& GetStats() const { return rasterizer.stats; }
+        void ResetStats() { rasterizer.stats = RasterStats(); }
+        void AddStats(const RasterStats& other) { rasterizer.stats += other; }
 
-            for (int y = yStart; y <= yEnd; y++) {
-                int xStart = static_cast<int>(std::round(x1));
-                int xEnd = static_cast<int>(std::round(x2));
-                if (xStart > xEnd) std::swap(xStart, xEnd);
-                
-                DrawLine(xStart, y, xEnd, y);
-                x1 += m1;
-                x2 += m2;
+        // the depth buffer is only allocated once something asks for depth testing
+        void ClearDepth() {
+            if (depthBuffer.GetWidth() != framebuffer.GetWidth() || depthBuffer.GetHeight() != framebuffer.GetHeight()) {
+                depthBuffer.Resize(framebuffer.GetWidth(), framebuffer.GetHeight());
+                return;
             }
+            depthBuffer.Clear();
         }
-
-    public:
-        explicit Renderer2D(SDL_Renderer* sdlRenderer) : renderer(sdlRenderer) {}
-        
-        // Prevent copying
-        Renderer2D(const Renderer2D&) = delete;
-        Renderer2D& operator=(const Renderer2D&) = delete;
         
         
-        void Clear() { SDL_RenderClear(renderer); }
-        void Present() { SDL_RenderPresent(renderer); }
+        void Clear() {
+            PROFILE_FUNCTION();
+            if (backend == Backend::Framebuffer) {
+                framebuffer.Clear(packedDrawColor);
+                return;
+            }
+            DiscardQueued(); // would be cleared away anyway
+            SDL_RenderClear(renderer);
+        }
+
+        // Sends everything queued for the SDL backend, a handful of calls however many primitives there were.
+        // Within one color the draw order between points, lines and rects can't change the image
+        void Flush() {
+            PROFILE_FUNCTION();
+            if (!queuedPoints.empty()) SDL_RenderDrawPoints(renderer, queuedPoints.data(), static_cast<int>(queuedPoints.size()));
+            if (!queuedFillRects.empty()) SDL_RenderFillRects(renderer, queuedFillRects.data(), static_cast<int>(queuedFillRects.size()));
+            if (!queuedOutlineRects.empty()) SDL_RenderDrawRectsF(renderer, queuedOutlineRects.data(), static_cast<int>(queuedOutlineRects.size()));
+
+            const SDL_FPoint* strip = queuedLinePoints.data();
+            for (int length : queuedStripLengths) {
+                SDL_RenderDrawLinesF(renderer, strip, length);
+                strip += length;
+            }
+            DiscardQueued();
+        }
+
+        void Present() {
+            PROFILE_FUNCTION();
+            Flush();
+            if (backend == Backend::Framebuffer) {
+                SDL_UpdateTexture(framebufferTexture, nullptr, framebuffer.GetPixels(), framebuffer.GetPitch());
+                SDL_RenderCopy(renderer, framebufferTexture, nullptr, nullptr);
+            }
+            SDL_RenderPresent(renderer);
+        }
         
         
         
         void SetDrawColor(const Color3& color) {
-            SDL_SetRenderDrawColor(renderer, color.components[0], color.components[1], color.components[2], 255);
+            SetDrawColor(Color4(color.components[0], color.components[1], color.components[2], 255));
         }
 
         void SetDrawColor(const Color4& color) {
-            SDL_SetRenderDrawColor(renderer, color.components[0], color.components[1], color.components[2], color.components[3]);
+            uint32_t packedColor = Framebuffer::PackColor(color.components[0], color.components[1], color.components[2], color.components[3]);
+            if (backend == Backend::SDL && packedColor != packedDrawColor) Flush();
+            drawColor = color;
+            packedDrawColor = packedColor;
+            rasterizer.SetColor(packedDrawColor);
+            if (backend == Backend::SDL) {
+                SDL_SetRenderDrawColor(renderer, color.components[0], color.components[1], color.components[2], color.components[3]);
+            }
         }
         
                 
         template <typename ComponentType>
         void DrawPoint(const Vector<ComponentType,2>& point) {
-            SDL_RenderDrawPoint(renderer, point.components[0], point.components[1]);
+            DrawPoint(point.components[0], point.components[1]);
         }
 
         void DrawPoint(int x, int y){
-            SDL_RenderDrawPoint(renderer, x, y);
+            if (backend == Backend::Framebuffer) framebuffer.SetPixel(x, y, packedDrawColor);
+            else queuedPoints.push_back({ x, y });
         }
 
         template <typename ComponentType>
@@ -108,51 +218,60 @@ class Renderer2D {
         }
 
         void DrawPointWithCustomWidth(float x, float y, float width){
-            SDL_FRect pointRectangle{
-                x,
-                y,
-                width,
-                width
-            };
-            SDL_RenderDrawRectF(renderer, &pointRectangle);
+            if (backend == Backend::Framebuffer) {
+                int size = static_cast<int>(width);
+                framebuffer.DrawRect(static_cast<int>(x), static_cast<int>(y), size, size, packedDrawColor);
+                return;
+            }
+            queuedOutlineRects.push_back({ x, y, width, width });
         }
 
         template <typename ComponentType>
         void DrawLine(const Vector<ComponentType, 2>& start, const Vector<ComponentType, 2>& end) {
-            SDL_RenderDrawLine(renderer, start.components[0], start.components[1], end.components[0], end.components[1]);
+            if (backend == Backend::Framebuffer) {
+                framebuffer.DrawLine(start.components[0], start.components[1], end.components[0], end.components[1], packedDrawColor);
+                return;
+            }
+            // SDL_RenderDrawLine took ints, keep snapping the same way
+            QueueLine(static_cast<int>(start.components[0]), static_cast<int>(start.components[1]),
+                      static_cast<int>(end.components[0]), static_cast<int>(end.components[1]));
         }
 
         void DrawLine(int x1, int y1, int x2, int y2){
-            SDL_RenderDrawLine(renderer, x1, y1, x2, y2);
+            if (backend == Backend::Framebuffer) framebuffer.DrawLine(x1, y1, x2, y2, packedDrawColor);
+            else QueueLine(x1, y1, x2, y2);
         }
 
         template <typename ComponentType>
         void DrawRect(const Vector<ComponentType, 2>& position, const Vector<ComponentType, 2>& size) {
             SDL_Rect rect = {
-                position.components[0],
-                position.components[1],
-                size.components[0],
-                size.components[1]
+                static_cast<int>(position.components[0]),
+                static_cast<int>(position.components[1]),
+                static_cast<int>(size.components[0]),
+                static_cast<int>(size.components[1])
             };
-            SDL_RenderDrawRect(renderer, &rect);
+            if (backend == Backend::Framebuffer) framebuffer.DrawRect(rect.x, rect.y, rect.w, rect.h, packedDrawColor);
+            else queuedOutlineRects.push_back({ float(rect.x), float(rect.y), float(rect.w), float(rect.h) });
         }
 
         template <typename ComponentType>
         void FillRect(const Vector<ComponentType, 2>& position, const Vector<ComponentType, 2>& size) {
             SDL_Rect rect = {
-                position.components[0],
-                position.components[1],
-                size.components[0],
-                size.components[1]
+                static_cast<int>(position.components[0]),
+                static_cast<int>(position.components[1]),
+                static_cast<int>(size.components[0]),
+                static_cast<int>(size.components[1])
             };
-            SDL_RenderFillRect(renderer, &rect);
+            if (backend == Backend::Framebuffer) framebuffer.FillRect(rect.x, rect.y, rect.x + rect.w, rect.y + rect.h, packedDrawColor);
+            else queuedFillRects.push_back(rect);
         }
 
         void FillRect(int x1, int y1, int x2, int y2){
-            SDL_Rect rect = {
-                x1, y1, x2 - x1, y2 - y1
-            };
-            SDL_RenderFillRect(renderer, &rect);
+            if (backend == Backend::Framebuffer) {
+                framebuffer.FillRect(x1, y1, x2, y2, packedDrawColor);
+                return;
+            }
+            queuedFillRects.push_back({ x1, y1, x2 - x1, y2 - y1 });
         }
 
         template<typename ComponentType>
@@ -215,8 +334,11 @@ class Renderer2D {
 
         template <typename ComponentType>
         void DrawTriangle(const Polygon2D<ComponentType, 3> &triangle) {
-            if (triangle.vertices.size() < 2) return;
-            
+            if (backend == Backend::Framebuffer) {
+                rasterizer.DrawTriangle(ToTriangle2D(triangle));
+                return;
+            }
+
             for (size_t i = 0; i < triangle.vertices.size() - 1; i++) {
                 DrawLine(triangle.vertices[i], triangle.vertices[i + 1]);
             }
@@ -225,22 +347,76 @@ class Renderer2D {
 
         template <typename ComponentType>
         void FillTriangle(const Polygon2D<ComponentType, 3>& triangle) {
-            std::array<Vector2, 3> vertices = { triangle.vertices[0], triangle.vertices[1], triangle.vertices[2] };
-            std::sort(vertices.begin(), vertices.end(), [](const Vector2& a, const Vector2& b) {
-                return a[1] < b[1];
+            if (backend == Backend::Framebuffer) {
+                rasterizer.FillTriangle(ToTriangle2D(triangle));
+                return;
+            }
+
+            Rasterizer::ScanTriangle(ToTriangle2D(triangle), GetWindowClipRect(), [this](int y, int xStart, int xEnd) {
+                queuedFillRects.push_back({ xStart, y, xEnd - xStart + 1, 1 });
+                rasterizer.stats.pixelsShaded += xEnd - xStart + 1;
             });
+        }
+
+        // Triangle list, three vertices per triangle, drawn with one SDL_RenderGeometry call.
+        // The framebuffer backend fills each triangle flat in its first vertex's color
+        void FillGeometry(const SDL_Vertex* vertices, int count) {
+            if (backend == Backend::SDL) {
+                Flush(); // geometry carries its own colors, queued primitives have to go first
+                SDL_RenderGeometry(renderer, nullptr, vertices, count, nullptr, 0);
+                return;
+            }
 
-            const Vector2 &v1 = vertices[0], &v2 = vertices[1], &v3 = vertices[2];
-            if (v2[1] == v3[1]) {
-                FillFlatTopTriangle(v1, v2, v3);
-            } else if (v1[1] == v2[1]) {
-                FillFlatBottomTriangle(v1, v2, v3);
-            } else {
-                float t = (v2[1] - v1[1]) / (v3[1] - v1[1]);
-                Vector2 v4 = v1 + (v3 - v1) * t;
-                FillFlatBottomTriangle(v1, v2, v4);
-                FillFlatTopTriangle(v2, v4, v3);
+            for (int i = 0; i + 2 < count; i += 3) {
+                const SDL_Color& color = vertices[i].color;
+                rasterizer.SetColor(Framebuffer::PackColor(color.r, color.g, color.b, color.a));
+                rasterizer.FillTriangle(Triangle2D(Vector2(vertices[i].position.x, vertices[i].position.y),
+                                                   Vector2(vertices[i + 1].position.x, vertices[i + 1].position.y),
+                                                   Vector2(vertices[i + 2].position.x, vertices[i + 2].position.y)));
             }
+            rasterizer.SetColor(packedDrawColor);
+        }
+
+        // Depth tested fill; depths are the projected z of each corner and ClearDepth() must have run this frame
+        template <typename ComponentType>
+        void FillTriangle(const Polygon2D<ComponentType, 3>& triangle, const std::array<float, 3>& depths) {
+            if (backend == Backend::Framebuffer) {
+                rasterizer.FillTriangle(ToTriangle2D(triangle), depths);
+                return;
+            }
+
+            // SDL can't depth test for us, so every visible run of a span goes out as a one pixel high rect
+            rasterizer.FillTriangle(ToTriangle2D(triangle), depths, [this](int y, int xStart, int xEnd) {
+                queuedFillRects.push_back({ xStart, y, xEnd - xStart + 1, 1 });
+            });
+        }
+
+        // Depth tested outline, hidden edges stay hidden
+        template <typename ComponentType>
+        void DrawTriangle(const Polygon2D<ComponentType, 3>& triangle, const std::array<float, 3>& depths) {
+            if (backend == Backend::Framebuffer) {
+                rasterizer.DrawTriangle(ToTriangle2D(triangle), depths);
+                return;
+            }
+
+            // one SDL line per visible stretch of each edge
+            int segmentStartX = 0, segmentStartY = 0, lastX = 0, lastY = 0;
+            bool inSegment = false;
+            rasterizer.DrawTriangle(ToTriangle2D(triangle), depths, [&](int x, int y, bool visible) {
+                bool continuesSegment = inSegment && std::abs(x - lastX) <= 1 && std::abs(y - lastY) <= 1;
+                if (inSegment && (!visible || !continuesSegment)) {
+                    QueueLine(segmentStartX, segmentStartY, lastX, lastY);
+                    inSegment = false;
+                }
+                if (visible && !inSegment) {
+                    segmentStartX = x;
+                    segmentStartY = y;
+                    inSegment = true;
+                }
+                lastX = x;
+                lastY = y;
+            });
+            if (inSegment) QueueLine(segmentStartX, segmentStartY, lastX, lastY);
         }
                 
         
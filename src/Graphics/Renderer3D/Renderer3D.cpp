@@ -1,57 +1,709 @@
 #include <algorithm>
+#include <limits>
+#include <math.h>
+#include <assert.h>
+#include <numeric>
+#include <bit>
 #include "Renderer3D.h"
 #include "../../Core/Math/Vector.h"
-#include "../../Enums/Colors.h"
+#include "../../Core/Utilities/MathFunctions.h"
+#include "../../Engine/ThreadPool/ThreadPool.h"
+#include "../VertexKernels/VertexKernels.h"
+#include "../../Engine/Profiler/Profiler.h"
+
+
+uint32_t Renderer3D::PackColor(const Color3& color) {
+    return Framebuffer::PackColor(color.components[0], color.components[1], color.components[2]);
+}
+
+// NDC to window pixels
+Renderer3D::Triangle2D Renderer3D::ToScreenSpace(const Triangle3D& transformed) const {
+    Triangle2D projected;
+    for (int i = 0; i < 3; i++) {
+        float x = transformed.vertices[i].position[0];
+        float y = transformed.vertices[i].position[1];
+
+        x = (x + 1.0f) * 0.5f * windowWidth;
+        y = (y + 1.0f) * 0.5f * windowHeight;
+
+        projected.vertices[i] = Vector<float, 2>(x, y);
+    }
+    return projected;
+}
+
+std::array<float, 3> Renderer3D::GetDepths(const Triangle3D& transformed) {
+    return { transformed.vertices[0].position[2], transformed.vertices[1].position[2], transformed.vertices[2].position[2] };
+}
+
+void Renderer3D::SetWindowDimensions(float width, float height) {
+    windowWidth = width;
+    windowHeight = height;
+    clipper.SetViewport(width, height);
+}
+
+Renderer3D::Color3 Renderer3D::GetFillColor(const Material<float>& material) {
+    Color3 color;
+    for (int i = 0; i < 3; i++) {
+        color[i] = static_cast<uint8_t>(std::clamp(material.diffuseColor[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+    return color;
+}
+
+void Renderer3D::SetMaterial(const Material<float>& material) {
+    fillColor = GetFillColor(material);
+}
+
+void Renderer3D::Clear() {
+    renderer2D->Clear();
+    if (depthMode == DepthMode::DepthBuffer) renderer2D->ClearDepth();
+    renderer2D->ResetStats();
+    stats = RenderStats();
+    frameList.triangles.clear();
+    frameList.colors.clear();
+    pendingFirst = 0;
+    pendingIds.clear();
+}
+
+// Buffers that survive the frame are sized for every triangle being visible, and a share of them being
+// clipped into more pieces, so their high water mark is reached on the first frame instead of whenever the view
+// changes. Painter's sort takes the whole frame at once, so they also make room for what earlier Render calls left.
+// Sizes round up to a power of two, a count creeping up over many frames, like levels of detail getting
+// finer while the camera comes closer, reallocates a few times instead of every frame
+void Renderer3D::ReserveScratch(const MeshType& mesh, size_t triangleCount, bool depthTesting) {
+    triangleCount = std::bit_ceil(triangleCount + triangleCount / clipHeadroomDivisor);
+    DrawList& target = recording ? *recording : frameList;
+    const size_t frameCount = std::bit_ceil(target.triangles.size() + triangleCount);
+    target.triangles.reserve(frameCount);
+    target.colors.reserve(frameCount);
+    target.drawOrder.reserve(frameCount);
+    target.batches.reserve(target.batches.size() + 3);     // both occlusion passes and the flush
+
+    triangleDepths.reserve(frameCount);
+    submissionOrder.reserve(frameCount);
+    if (depthTesting) {
+        GetSorter(&mesh, 0).Reserve(triangleCount);
+        if (occlusionCulling) GetSorter(&mesh, 1).Reserve(triangleCount);
+    }
+    else {
+        pendingIds.reserve(pendingIds.size() + triangleCount);
+        GetSorter(nullptr, 0).Reserve(frameCount);
+    }
+    renderer2D->ReserveLines(frameCount * 3);
+}
+
+// a mesh drawn for the first time adds its sorters, later frames find them
+DepthSorter& Renderer3D::GetSorter(const MeshType* mesh, int pass) {
+    for (BatchSorter& batchSorter : depthSorters) {
+        if (batchSorter.mesh == mesh && batchSorter.pass == pass) return batchSorter.sorter;
+    }
+    depthSorters.push_back({ mesh, pass, DepthSorter() });
+    depthSorters.back().sorter.SetTemporalCoherence(temporalSorting);
+    return depthSorters.back().sorter;
+}
+
+// One vertex array for the whole frame, already in painter's order. Each triangle's outline follows its fill as
+// three thin quads, so outlines get covered like the fills and the frame is still a single SDL_RenderGeometry call
+void Renderer3D::RenderBatched(std::span<const Triangle3D> transformedTriangles, std::span<const Color3> triangleColors,
+            std::span<const uint32_t> drawOrder) {
+    PROFILE_FUNCTION();
+    const size_t verticesPerTriangle = batchedOutlines ? 3 + 3 * 6 : 3;
+    const SDL_Color outlineVertexColor = { outlineColor[0], outlineColor[1], outlineColor[2], 255 };
+
+    FrameVector<SDL_Vertex> geometryVertices;
+    geometryVertices.reserve(drawOrder.size() * verticesPerTriangle);
+    for (uint32_t index : drawOrder) {
+        Triangle2D projected = ToScreenSpace(transformedTriangles[index]);
+        const Color3& color = triangleColors[index];
+        const SDL_Color vertexColor = { color[0], color[1], color[2], 255 };
+        for (int i = 0; i < 3; i++) {
+            geometryVertices.push_back({ { projected.vertices[i][0], projected.vertices[i][1] }, vertexColor, { 0.0f, 0.0f } });
+        }
+        if (!batchedOutlines) continue;
+
+        // every edge widened by half a pixel to either side
+        for (int i = 0; i < 3; i++) {
+            const Vector<float, 2>& start = projected.vertices[i];
+            const Vector<float, 2>& end = projected.vertices[(i + 1) % 3];
+            float dx = end[0] - start[0], dy = end[1] - start[1];
+            float length = sqrtf(dx * dx + dy * dy);
+            float offsetX = length > 0.0f ? -dy / length * 0.5f : 0.5f;
+            float offsetY = length > 0.0f ? dx / length * 0.5f : 0.0f;
+
+            const SDL_FPoint corners[4] = { { start[0] + offsetX, start[1] + offsetY }, { start[0] - offsetX, start[1] - offsetY },
+                                            { end[0] - offsetX, end[1] - offsetY }, { end[0] + offsetX, end[1] + offsetY } };
+            for (int corner : { 0, 1, 2, 0, 2, 3 }) geometryVertices.push_back({ corners[corner], outlineVertexColor, { 0.0f, 0.0f } });
+        }
+    }
+    renderer2D->FillGeometry(geometryVertices.data(), static_cast<int>(geometryVertices.size()));
+}
+
+// Fills the whole vertex cache up front: the matrix goes over the position streams 8 vertices at a time,
+// then every distinct position gets its divide and outcode
+void Renderer3D::TransformVertexStreams(const MeshType& mesh, TransformStage& stage) {
+    const size_t count = mesh.vertices.size();
+    const VertexStreams<float>& streams = mesh.streams;
+    FrameVector<float> clipX(count), clipY(count), clipZ(count), clipW(count);
+    VertexKernels::TransformPositions(streams.x.data(), streams.y.data(), streams.z.data(), count, stage.clipMatrix,
+                                      clipX.data(), clipY.data(), clipZ.data(), clipW.data());
+
+    const bool sharedPositions = mesh.positionIndices.size() == count;
+    for (size_t i = 0; i < count; i++) {
+        if (sharedPositions && mesh.positionIndices[i] != i) continue;
+        stage.vertexCache[i] = clipper.FromClipSpace(Vector<float, 4>(clipX[i], clipY[i], clipZ[i], clipW[i]));
+        stage.vertexCached[i] = 1;
+        stats.verticesTransformed++;
+    }
+}
+
+// Appends the indices of clusters not entirely outside the frustum and not facing away, in mesh order. The planes
+// and the camera position come out of the instance's clip matrix, so they are already in the mesh's own space
+// and the cluster bounds need no transform
+void Renderer3D::CollectVisibleClusters(const std::vector<Cluster>& clusters, const ClusterTree* clusterTree,
+            const Matrix<float, 4, 4>& clipMatrix, FrameVector<uint32_t>& output) {
+    const Frustum<float> frustum = Frustum<float>::FromMatrix(clipMatrix, clipper.GetNearPlane(), clipper.GetFarPlane());
+    const Vector<float, 3> eye = Frustum<float>::GetApex(clipMatrix);
+    const size_t first = output.size();
+
+    auto addUnlessBackFacing = [&](uint32_t cluster) {
+        if (!clusters[cluster].IsBackFacing(eye)) {
+            output.push_back(cluster);
+            return;
+        }
+        stats.clustersBackfaceCulled++;
+        stats.trianglesBackfaceCulled += clusters[cluster].count;
+    };
+
+    // a tree leaf holds a few clusters, their spheres can still be outside where the leaf's box isn't
+    if (clusterTree && !clusterTree->IsEmpty()) {
+        clusterTree->Query(frustum, [&](uint32_t cluster) {
+            if (frustum.IntersectsSphere(clusters[cluster].sphereCenter, clusters[cluster].sphereRadius)) addUnlessBackFacing(cluster);
+        });
+        std::sort(output.begin() + first, output.end());
+        return;
+    }
+    for (size_t i = 0; i < clusters.size(); i++) {
+        if (frustum.IntersectsBox(clusters[i].boundsMin, clusters[i].boundsMax)) addUnlessBackFacing(static_cast<uint32_t>(i));
+    }
+}
+
+// Points the stage at one instance. Its vertex cache starts empty unless that instance is the one already cached
+void Renderer3D::SelectInstance(const MeshType& mesh, size_t instance, const Matrix<float, 4, 4>& clipMatrix,
+            bool transformAll, TransformStage& stage) {
+    if (stage.cachedInstance == instance) return;
+    stage.cachedInstance = instance;
+    stage.clipMatrix = clipMatrix;
+    std::fill(stage.vertexCached.begin(), stage.vertexCached.end(), 0);
+    if (transformAll && mesh.HasVertexStreams()) TransformVertexStreams(mesh, stage);
+}
+
+// Clip, divide and back face cull triangles [first, first + count) into output. Each one that comes out gets
+// an id in outputIds that names it again next frame: instanceKey, the mesh triangle and which of its clipped pieces
+void Renderer3D::TransformTriangles(const MeshType& mesh, size_t first, size_t count, uint64_t instanceKey,
+            TransformStage& stage, FrameVector<Triangle3D>& output, FrameVector<uint64_t>& outputIds) {
+
+    // vertices that only differ in normal or texture coordinates share one cache entry
+    const bool sharedPositions = mesh.positionIndices.size() == mesh.vertices.size();
+
+    // the id is instanceKey << 32 | triangle << 3 | piece: triangle indices have to fit in 29 bits and
+    // pieces in 3, or ids collide and next frame's sort reuses the wrong triangles' order
+    constexpr int pieceBits = 3;
+    static_assert(FrustumClipper::maxClippedTriangles <= (1 << pieceBits), "clipped pieces don't fit the id");
+    assert(first + count <= (size_t(1) << (32 - pieceBits)));
+
+    size_t outputStart = output.size();
+    for (size_t i = first; i < first + count; i++) {
+        const Vertex3<float>* vertices[3];
+        const FrustumClipper::TransformedVertex* corners[3];
+        for (int corner = 0; corner < 3; corner++) {
+            uint32_t vertex = mesh.indices[i * 3 + corner];
+            uint32_t cacheIndex = sharedPositions ? mesh.positionIndices[vertex] : vertex;
+            if (!stage.vertexCached[cacheIndex]) {
+                stage.vertexCache[cacheIndex] = clipper.Transform(mesh.vertices[cacheIndex].position, stage.clipMatrix);
+                stage.vertexCached[cacheIndex] = 1;
+                stats.verticesTransformed++;
+            }
+            vertices[corner] = &mesh.vertices[vertex];
+            corners[corner] = &stage.vertexCache[cacheIndex];
+        }
+
+        size_t piecesStart = output.size();
+        FrustumClipper::Result result = clipper.Clip(vertices, corners, output);
+        if (result == FrustumClipper::Result::Outside) stats.trianglesOutsideFrustum++;
+        if (result == FrustumClipper::Result::Clipped) stats.trianglesClipped++;
+        for (size_t piece = 0; piece < output.size() - piecesStart; piece++) outputIds.push_back(instanceKey << 32 | i << pieceBits | piece);
+    }
+
+    // back faces and degenerate pieces go, the ids move along with the triangles they belong to
+    const Vector<float, 3>& cameraPosition = stage.cameraPosition;
+    size_t clippedCount = output.size(), kept = outputStart;
+    for (size_t i = outputStart; i < clippedCount; i++) {
+        Vector<float, 3> normal = output[i].GetNormal();
+        if (normal.SquaredComponentSum() < 1e-10f || (normal * (output[i].vertices[0].position - cameraPosition)) < -0.01f) continue;
+        output[kept] = output[i];
+        outputIds[kept] = outputIds[i];
+        kept++;
+    }
+    output.erase(output.begin() + kept, output.end());
+    outputIds.erase(outputIds.begin() + kept, outputIds.end());
+
+    stats.trianglesCulled += clippedCount - output.size();
+}
+
+// Screen rectangle of the cluster's box against the depth pyramid. Boxes reaching behind the near plane
+// can't be projected and always count as visible
+bool Renderer3D::IsClusterOccluded(const Cluster& cluster, const Matrix<float, 4, 4>& clipMatrix) const {
+    float xMin = windowWidth, yMin = windowHeight, xMax = 0.0f, yMax = 0.0f;
+    float nearestDepth = std::numeric_limits<float>::lowest();
+
+    Vector<float, 3> corners[8];
+    Vector<float, 4> clipCorners[8];
+    for (int corner = 0; corner < 8; corner++) {
+        corners[corner] = Vector<float, 3>(corner & 1 ? cluster.boundsMax[0] : cluster.boundsMin[0],
+                                           corner & 2 ? cluster.boundsMax[1] : cluster.boundsMin[1],
+                                           corner & 4 ? cluster.boundsMax[2] : cluster.boundsMin[2]);
+    }
+    MathFunctions::Matrices::TransformPointsHomogeneous(corners, clipMatrix, clipCorners);
+
+    for (const Vector<float, 4>& clipPosition : clipCorners) {
+        if (-clipPosition[3] < clipper.GetNearPlane()) return false;
+
+        float x = (clipPosition[0] / clipPosition[3] + 1.0f) * 0.5f * windowWidth;
+        float y = (clipPosition[1] / clipPosition[3] + 1.0f) * 0.5f * windowHeight;
+        xMin = std::min(xMin, x);
+        xMax = std::max(xMax, x);
+        yMin = std::min(yMin, y);
+        yMax = std::max(yMax, y);
+        nearestDepth = std::max(nearestDepth, clipPosition[2] / clipPosition[3]);
+    }
+
+    // a pixel of slack for rounding in the rasterizers, and the outline depth bias on top of the plane
+    int pixelXMin = std::max(static_cast<int>(std::floor(xMin)) - 1, 0);
+    int pixelYMin = std::max(static_cast<int>(std::floor(yMin)) - 1, 0);
+    int pixelXMax = std::min(static_cast<int>(std::ceil(xMax)) + 1, static_cast<int>(windowWidth) - 1);
+    int pixelYMax = std::min(static_cast<int>(std::ceil(yMax)) + 1, static_cast<int>(windowHeight) - 1);
+    if (pixelXMin > pixelXMax || pixelYMin > pixelYMax) return true; // entirely off-screen
+
+    return hierarchicalZ.IsOccluded(pixelXMin, pixelYMin, pixelXMax, pixelYMax, nearestDepth + 2.0f * Rasterizer::outlineDepthBias);
+}
+
+// Projected size of the sphere around levels[0]'s box: its radius scaled like the mesh, over its depth, times
+// row 1 of the projection. The view is a rotation and a move, so row 1 of projection * view still has that as its length
+size_t Renderer3D::SelectLevel(std::span<const LevelOfDetail> levels, const Instance& instance,
+            const Matrix<float, 4, 4>& projectionMatrix) {
+    if (levels.size() < 2 || !levels[0].clusterTree || levels[0].clusterTree->IsEmpty()) return 0;
+
+    const ClusterTree::Box& bounds = levels[0].clusterTree->GetBounds();
+    const Matrix<float, 4, 4>& worldMatrix = instance.transformationMatrix;
+    const Matrix<float, 4, 4> clipMatrix = projectionMatrix * worldMatrix;
+
+    float center[3], radiusSquared = 0.0f, scaleSquared = 0.0f, projectionScale = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        center[axis] = (bounds.boundsMin[axis] + bounds.boundsMax[axis]) * 0.5f;
+        radiusSquared += (bounds.boundsMax[axis] - center[axis]) * (bounds.boundsMax[axis] - center[axis]);
+        float columnSquared = 0.0f;
+        for (int row = 0; row < 3; row++) columnSquared += worldMatrix(row, axis) * worldMatrix(row, axis);
+        scaleSquared = std::max(scaleSquared, columnSquared);
+        projectionScale += projectionMatrix(1, axis) * projectionMatrix(1, axis);
+    }
+    float depth = -(clipMatrix(3, 0) * center[0] + clipMatrix(3, 1) * center[1] + clipMatrix(3, 2) * center[2] + clipMatrix(3, 3));
+    float radius = sqrtf(radiusSquared * scaleSquared);
+
+    // the camera inside the sphere, the mesh can fill the whole window
+    float coveredPixels = windowWidth * windowHeight;
+    if (depth > radius) {
+        float pixelRadius = radius * sqrtf(projectionScale) / depth * windowHeight * 0.5f;
+        coveredPixels = std::min(coveredPixels, 3.14159f * pixelRadius * pixelRadius);
+    }
+    const float triangleBudget = coveredPixels / levelPixelsPerTriangle;
+
+    size_t level = 0;
+    while (level + 1 < levels.size() && levels[level].mesh->GetTriangleCount() > triangleBudget) level++;
+    if (instance.id == noInstanceId) return level;
+
+    // the last frame's level stays while the budget is within the hysteresis of its thresholds
+    if (instanceLevels.size() <= instance.id) instanceLevels.resize(instance.id + 1, UINT8_MAX);
+    size_t lastLevel = instanceLevels[instance.id];
+    if (lastLevel < levels.size() && lastLevel != level) {
+        bool stillFits = levels[lastLevel].mesh->GetTriangleCount() <= triangleBudget * (1.0f + levelHysteresis);
+        bool finerStillTooBig = lastLevel == 0 || levels[lastLevel - 1].mesh->GetTriangleCount() > triangleBudget * (1.0f - levelHysteresis);
+        if (stillFits && finerStillTooBig) level = lastLevel;
+    }
+    instanceLevels[instance.id] = static_cast<uint8_t>(level);
+    return level;
+}
+
+
+// Painter's order is the whole frame's, so without the depth buffer triangles only join the frame's list and
+// Flush sorts and draws them. Sorting is part of the view, so it goes into the draw list being recorded
+void Renderer3D::RasterizeTriangles(const FrameVector<Triangle3D>& transformedTriangles, const FrameVector<Color3>& triangleColors,
+            const FrameVector<uint64_t>& triangleIds, bool depthTesting, const MeshType& mesh, int pass) {
+    stats.trianglesRasterized += transformedTriangles.size();
+    if (!depthTesting) {
+        DrawList& target = recording ? *recording : frameList;
+        target.triangles.insert(target.triangles.end(), transformedTriangles.begin(), transformedTriangles.end());
+        target.colors.insert(target.colors.end(), triangleColors.begin(), triangleColors.end());
+        pendingIds.insert(pendingIds.end(), triangleIds.begin(), triangleIds.end());
+        return;
+    }
+
+    const std::vector<uint32_t>& drawOrder = SortTriangles(transformedTriangles, triangleIds, depthTesting, GetSorter(&mesh, pass));
+
+    if (recording) {
+        recording->batches.push_back({ recording->triangles.size(), transformedTriangles.size(), depthTesting });
+        recording->triangles.insert(recording->triangles.end(), transformedTriangles.begin(), transformedTriangles.end());
+        recording->colors.insert(recording->colors.end(), triangleColors.begin(), triangleColors.end());
+        recording->drawOrder.insert(recording->drawOrder.end(), drawOrder.begin(), drawOrder.end());
+        pendingFirst = recording->triangles.size();
+        if (!recording->rasterizedByRecorder) return;
+    }
+    DrawTriangles(transformedTriangles, triangleColors, drawOrder, depthTesting);
+}
+
+const std::vector<uint32_t>& Renderer3D::SortTriangles(std::span<const Triangle3D> transformedTriangles,
+            std::span<const uint64_t> triangleIds, bool depthTesting, DepthSorter& sorter) {
+    PROFILE_FUNCTION();
+    // Painter's algorithm draws back to front, larger z is nearer. With the depth buffer the order only matters
+    // for overdraw, so it's flipped to front to back or skipped. Only indices get sorted, the triangles stay put
+    const std::vector<uint32_t>* drawOrder = &submissionOrder;
+    if (!depthTesting || frontToBackSorting) {
+        triangleDepths.resize(transformedTriangles.size());
+        for (size_t i = 0; i < transformedTriangles.size(); i++) {
+            const Triangle3D& transformed = transformedTriangles[i];
+            triangleDepths[i] = transformed.vertices[0].position[2] + transformed.vertices[1].position[2] + transformed.vertices[2].position[2];
+        }
+        drawOrder = &sorter.Sort(triangleDepths, triangleIds, depthTesting ? DepthSorter::Direction::FrontToBack : DepthSorter::Direction::BackToFront);
+    }
+    else {
+        submissionOrder.resize(transformedTriangles.size());
+        std::iota(submissionOrder.begin(), submissionOrder.end(), 0u);
+    }
+    return *drawOrder;
+}
+
+void Renderer3D::DrawTriangles(std::span<const Triangle3D> transformedTriangles, std::span<const Color3> triangleColors,
+            std::span<const uint32_t> drawOrder, bool depthTesting) {
+    PROFILE_FUNCTION();
+    bool batched = batchedGeometry && !depthTesting && renderer2D->GetBackend() == Renderer2D::Backend::SDL;
+
+    // with a single hardware thread binning is pure overhead
+    bool tiled = tiledRasterization && renderer2D->GetBackend() == Renderer2D::Backend::Framebuffer &&
+                 ThreadPool::GetInstance().GetWorkerCount() > 1;
+
+    if (batched) {
+        RenderBatched(transformedTriangles, triangleColors, drawOrder);
+    }
+    else if (tiled) {
+        FrameVector<RasterTriangle> rasterTriangles;
+        rasterTriangles.reserve(transformedTriangles.size());
+
+        const uint32_t packedOutlineColor = PackColor(outlineColor);
+        for (uint32_t index : drawOrder) {
+            const Triangle3D& transformed = transformedTriangles[index];
+            rasterTriangles.push_back({ ToScreenSpace(transformed), GetDepths(transformed), PackColor(triangleColors[index]), packedOutlineColor });
+        }
+
+        RasterStats tileStats;
+        tileRenderer.Render(rasterTriangles, renderer2D->GetFramebuffer(), depthTesting ? &renderer2D->GetDepthBuffer() : nullptr, tileStats);
+        renderer2D->AddStats(tileStats);
+    }
+    else {
+        for (uint32_t index : drawOrder) {
+            const Triangle3D& transformed = transformedTriangles[index];
+            Triangle2D projected = ToScreenSpace(transformed);
+        
+            if (depthTesting) {
+                std::array<float, 3> depths = GetDepths(transformed);
+                renderer2D->SetDrawColor(triangleColors[index]);
+                renderer2D->FillTriangle(projected, depths);
+
+                renderer2D->SetDrawColor(outlineColor);
+                renderer2D->DrawTriangle(projected, depths);
+                continue;
+            }
+        
+            renderer2D->SetDrawColor(triangleColors[index]);
+            renderer2D->FillTriangle(projected);
+
+            renderer2D->SetDrawColor(outlineColor);
+            renderer2D->DrawTriangle(projected);
+        }
+    }
+}
 
 void Renderer3D::Render(const std::vector<Triangle3D> &triangles, const Matrix<float, 4, 4> &transformationMatrix,
             const Matrix<float, 4, 4> &projectionMatrix, const Vector<float, 3>& cameraPosition){
+    Render(MeshType::FromTriangles(triangles), {}, transformationMatrix, projectionMatrix, cameraPosition);
+}
+
+void Renderer3D::Render(const MeshType& mesh, const std::vector<Cluster>& clusters,
+            const Matrix<float, 4, 4> &transformationMatrix, const Matrix<float, 4, 4> &projectionMatrix,
+            const Vector<float, 3>& cameraPosition){
+    const Instance instance = { transformationMatrix, nullptr };
+    Render(mesh, clusters, std::span<const Instance>(&instance, 1), projectionMatrix, cameraPosition);
+}
+
+void Renderer3D::Render(const MeshType& mesh, const std::vector<Cluster>& clusters, std::span<const Instance> instances,
+            const Matrix<float, 4, 4> &projectionMatrix, const Vector<float, 3>& cameraPosition, const ClusterTree* clusterTree){
+    RenderLevel(mesh, clusters, instances, projectionMatrix, cameraPosition, clusterTree, 0);
+}
+
+// an id or level seen for the first time allocates, the same ones next frame don't
+void Renderer3D::ReserveClusterVisibility(uint32_t id, size_t level, size_t clusterCount) {
+    if (clusterVisible.size() <= id) clusterVisible.resize(id + 1);
+    std::vector<std::vector<uint8_t>>& levels = clusterVisible[id];
+    if (levels.size() <= level) levels.resize(level + 1);
+    if (levels[level].size() != clusterCount) levels[level].assign(clusterCount, 1);
+}
 
-    std::vector<Triangle3D> transformedTriangles;
-    transformedTriangles.reserve(triangles.size());
+void Renderer3D::RenderLevel(const MeshType& mesh, const std::vector<Cluster>& clusters, std::span<const Instance> instances,
+            const Matrix<float, 4, 4> &projectionMatrix, const Vector<float, 3>& cameraPosition,
+            const ClusterTree* clusterTree, size_t level){
+    PROFILE_SCOPE("Render instances");
 
-    for (auto& triangle : triangles) {
-        Triangle3D transformed = triangle.CopyTransformedByMatrix4x4(projectionMatrix * transformationMatrix);
-        Vector<float, 3> normal = transformed.GetNormal();
-        if (normal.SquaredComponentSum() < 1e-10f) {
-            continue;
+    const size_t triangleCount = mesh.GetTriangleCount();
+    const size_t submittedCount = triangleCount * instances.size();
+    stats.trianglesSubmitted += submittedCount;
+
+    bool depthTesting = depthMode == DepthMode::DepthBuffer;
+
+    ReserveScratch(mesh, submittedCount, depthTesting);
+    FrameVector<Triangle3D> transformedTriangles;
+    FrameVector<Color3> triangleColors;     // parallel to transformedTriangles
+    FrameVector<uint64_t> triangleIds;      // same
+    transformedTriangles.reserve(submittedCount);
+    triangleColors.reserve(submittedCount);
+    triangleIds.reserve(submittedCount);
+
+    // combined once per instance, the clipper transforms and divides what survives
+    FrameVector<Matrix<float, 4, 4>> clipMatrices(instances.size());
+    FrameVector<Color3> instanceColors(instances.size());
+    for (size_t i = 0; i < instances.size(); i++) {
+        clipMatrices[i] = projectionMatrix * instances[i].transformationMatrix;
+        instanceColors[i] = instances[i].material ? GetFillColor(*instances[i].material) : fillColor;
+    }
+
+    // one vertex cache for the mesh, refilled for each instance in turn
+    TransformStage stage;
+    stage.cameraPosition = cameraPosition;
+    stage.vertexCache.resize(mesh.vertices.size());
+    stage.vertexCached.resize(mesh.vertices.size());
+
+    auto transformTriangles = [&](size_t instance, size_t first, size_t count) {
+        // the id stays with the instance while it has one, else its index in this call
+        uint64_t instanceKey = instances[instance].id != noInstanceId ? instances[instance].id : instance;
+        TransformTriangles(mesh, first, count, instanceKey, stage, transformedTriangles, triangleIds);
+        triangleColors.resize(transformedTriangles.size(), instanceColors[instance]);
+    };
+
+    if (clusters.empty()) {
+        for (size_t instance = 0; instance < instances.size(); instance++) {
+            SelectInstance(mesh, instance, clipMatrices[instance], true, stage);
+            transformTriangles(instance, 0, triangleCount);
         }
-        if ((normal * (transformed.vertices[0].position - cameraPosition)) < -0.01f) {
-            continue;
+        RasterizeTriangles(transformedTriangles, triangleColors, triangleIds, depthTesting, mesh, 0);
+    }
+    else {
+        // each instance's clusters that reach into the frustum and face the camera, instance i's from clustersStart[i]
+        const size_t backfaceCulledBefore = stats.clustersBackfaceCulled, backfaceTrianglesBefore = stats.trianglesBackfaceCulled;
+        FrameVector<uint32_t> clustersToDraw;
+        FrameVector<size_t> clustersStart(instances.size() + 1);
+        for (size_t instance = 0; instance < instances.size(); instance++) {
+            clustersStart[instance] = clustersToDraw.size();
+            CollectVisibleClusters(clusters, clusterTree, clipMatrices[instance], clustersToDraw);
         }
+        clustersStart[instances.size()] = clustersToDraw.size();
 
+        // The vectorized pass transforms every vertex of the mesh, worth it only while most of it is drawn.
+        // Otherwise vertices are transformed as the remaining triangles reach them
+        size_t trianglesToDraw = 0;
+        FrameVector<uint8_t> transformAll(instances.size());
+        for (size_t instance = 0; instance < instances.size(); instance++) {
+            size_t instanceTriangles = 0;
+            for (size_t i = clustersStart[instance]; i < clustersStart[instance + 1]; i++) instanceTriangles += clusters[clustersToDraw[i]].count;
+            transformAll[instance] = instanceTriangles * 4 >= triangleCount * 3;
+            trianglesToDraw += instanceTriangles;
+        }
+        stats.clustersFrustumCulled += clusters.size() * instances.size() - clustersToDraw.size() - (stats.clustersBackfaceCulled - backfaceCulledBefore);
+        stats.trianglesFrustumCulled += submittedCount - trianglesToDraw - (stats.trianglesBackfaceCulled - backfaceTrianglesBefore);
+
+        // occlusion needs depth to test against, painter's sort draws everything
+        if (!depthTesting || !occlusionCulling) {
+            for (size_t instance = 0; instance < instances.size(); instance++) {
+                for (size_t i = clustersStart[instance]; i < clustersStart[instance + 1]; i++) {
+                    const Cluster& cluster = clusters[clustersToDraw[i]];
+                    SelectInstance(mesh, instance, clipMatrices[instance], transformAll[instance], stage);
+                    transformTriangles(instance, cluster.first, cluster.count);
+                }
+            }
+            RasterizeTriangles(transformedTriangles, triangleColors, triangleIds, depthTesting, mesh, 0);
+        }
+        else {
+            // Two passes: whatever was visible last frame is drawn first as this frame's occluders, everything
+            // else is tested against the depth they left. Only clusters hidden by this frame's depth get skipped,
+            // so a moving camera never loses geometry, last frame only decides the order
+            FrameVector<uint8_t*> visible(instances.size(), nullptr);
+            for (size_t instance = 0; instance < instances.size(); instance++) {
+                uint32_t id = instances[instance].id;
+                if (id == noInstanceId) continue;
+                ReserveClusterVisibility(id, level, clusters.size());
+                visible[instance] = clusterVisible[id][level].data();
+            }
+            auto wasVisible = [&](size_t instance, uint32_t cluster) { return !visible[instance] || visible[instance][cluster]; };
+
+            for (size_t instance = 0; instance < instances.size(); instance++) {
+                for (size_t i = clustersStart[instance]; i < clustersStart[instance + 1]; i++) {
+                    if (!wasVisible(instance, clustersToDraw[i])) continue;
+                    const Cluster& cluster = clusters[clustersToDraw[i]];
+                    SelectInstance(mesh, instance, clipMatrices[instance], transformAll[instance], stage);
+                    transformTriangles(instance, cluster.first, cluster.count);
+                }
+            }
+            RasterizeTriangles(transformedTriangles, triangleColors, triangleIds, depthTesting, mesh, 0);
+            hierarchicalZ.Build(renderer2D->GetDepthBuffer());
 
-        transformedTriangles.push_back(transformed);
+            // few clusters come back into view at a time, so their vertices are transformed one by one
+            transformedTriangles.clear();
+            triangleColors.clear();
+            triangleIds.clear();
+            for (size_t instance = 0; instance < instances.size(); instance++) {
+                for (size_t i = clustersStart[instance]; i < clustersStart[instance + 1]; i++) {
+                    if (wasVisible(instance, clustersToDraw[i])) continue;
+                    const Cluster& cluster = clusters[clustersToDraw[i]];
+                    stats.clustersTested++;
+                    if (IsClusterOccluded(cluster, clipMatrices[instance])) {
+                        stats.clustersOccluded++;
+                        stats.trianglesOccluded += cluster.count;
+                        continue;
+                    }
+                    SelectInstance(mesh, instance, clipMatrices[instance], false, stage);
+                    transformTriangles(instance, cluster.first, cluster.count);
+                }
+            }
+            RasterizeTriangles(transformedTriangles, triangleColors, triangleIds, depthTesting, mesh, 1);
+
+            // next frame's occluders are the clusters the finished depth doesn't hide, outside the frustum is hidden
+            hierarchicalZ.Build(renderer2D->GetDepthBuffer());
+            for (size_t instance = 0; instance < instances.size(); instance++) {
+                if (!visible[instance]) continue;
+                std::fill(visible[instance], visible[instance] + clusters.size(), 0);
+                for (size_t i = clustersStart[instance]; i < clustersStart[instance + 1]; i++) {
+                    uint32_t cluster = clustersToDraw[i];
+                    visible[instance][cluster] = !IsClusterOccluded(clusters[cluster], clipMatrices[instance]);
+                }
+            }
+        }
     }
 
+    UpdatePixelStats();
+}
 
+void Renderer3D::UpdatePixelStats() {
+    const RasterStats& rasterStats = renderer2D->GetStats();
+    stats.pixelsShaded = rasterStats.pixelsShaded;
+    stats.pixelsRejected = rasterStats.pixelsRejected;
+    stats.overdraw = stats.pixelsShaded / std::max(windowWidth * windowHeight, 1.0f);
+}
 
-    // Sort by z depth (painter's algorithm)
-    std::sort(transformedTriangles.begin(), transformedTriangles.end(),
-    [](const Triangle3D &a, const Triangle3D &b) {
-        float z1 = (a.vertices[0].position[2] + a.vertices[1].position[2] + a.vertices[2].position[2]) / 3.0f;
-        float z2 = (b.vertices[0].position[2] + b.vertices[1].position[2] + b.vertices[2].position[2]) / 3.0f;
-        return z1 < z2;
-    });
+void Renderer3D::BeginRecording(DrawList& drawList) {
+    Flush();
+    drawList.triangles.clear();
+    drawList.colors.clear();
+    drawList.drawOrder.clear();
+    drawList.batches.clear();
+    drawList.recorder = this;
+    drawList.rasterizedByRecorder = depthMode == DepthMode::DepthBuffer && occlusionCulling;
+    recording = &drawList;
+    pendingFirst = 0;
+    pendingIds.clear();
+}
 
+void Renderer3D::EndRecording() {
+    Flush();
+    recording->stats = stats;
+    recording = nullptr;
+    pendingFirst = 0;
+}
 
+void Renderer3D::Flush() {
+    DrawList& target = recording ? *recording : frameList;
+    const size_t count = target.triangles.size() - pendingFirst;
+    if (count == 0) return;
 
-    for (const auto& transformed : transformedTriangles) {
-        auto projected = transformed.ToPolygon2D();
-        
-        for (int i = 0; i < 3; i++) {
-            float x = transformed.vertices[i].position[0];
-            float y = transformed.vertices[i].position[1];
+    const std::span<const Triangle3D> triangles = std::span<const Triangle3D>(target.triangles).subspan(pendingFirst);
+    const std::span<const Color3> colors = std::span<const Color3>(target.colors).subspan(pendingFirst);
+    const std::vector<uint32_t>& drawOrder = SortTriangles(triangles, pendingIds, false, GetSorter(nullptr, 0));
+    pendingIds.clear();
 
-            x = (x + 1.0f) * 0.5f * windowWidth;
-            y = (y + 1.0f) * 0.5f * windowHeight;
+    if (recording) {
+        recording->batches.push_back({ pendingFirst, count, false });
+        recording->drawOrder.insert(recording->drawOrder.end(), drawOrder.begin(), drawOrder.end());
+        pendingFirst = recording->triangles.size();
+        return;
+    }
+    DrawTriangles(triangles, colors, drawOrder, false);
+    frameList.triangles.clear();
+    frameList.colors.clear();
+    pendingFirst = 0;
+    UpdatePixelStats();
+}
 
-            projected.vertices[i] = Vector<float, 2>(x, y);
+void Renderer3D::Rasterize(const DrawList& drawList) {
+    PROFILE_FUNCTION();
+    if (drawList.recorder != this || !drawList.rasterizedByRecorder) {
+        renderer2D->ReserveLines(std::bit_ceil(drawList.triangles.size()) * 3);
+        const std::span<const Triangle3D> triangles = drawList.triangles;
+        const std::span<const Color3> colors = drawList.colors;
+        const std::span<const uint32_t> drawOrder = drawList.drawOrder;
+        for (const DrawList::Batch& batch : drawList.batches) {
+            DrawTriangles(triangles.subspan(batch.first, batch.count), colors.subspan(batch.first, batch.count),
+                          drawOrder.subspan(batch.first, batch.count), batch.depthTesting);
         }
-        
-        renderer2D->SetDrawColor(Colors::White);
-        renderer2D->FillTriangle(projected);
+    }
+    stats = drawList.stats;
+    UpdatePixelStats();
+}
+
+void Renderer3D::Render(std::span<const LevelOfDetail> levels, std::span<const Instance> instances,
+            const Matrix<float, 4, 4> &projectionMatrix, const Vector<float, 3>& cameraPosition){
+    PROFILE_SCOPE("Render levels of detail");
+    if (levels.empty()) return;
+
+    FrameVector<uint8_t> instanceLevel(instances.size());
+    FrameVector<size_t> levelCounts(levels.size(), 0);
+    for (size_t instance = 0; instance < instances.size(); instance++) {
+        size_t level = SelectLevel(levels, instances[instance], projectionMatrix);
+        instanceLevel[instance] = static_cast<uint8_t>(level);
+        levelCounts[level]++;
+        stats.trianglesSimplified += levels[0].mesh->GetTriangleCount() - levels[level].mesh->GetTriangleCount();
+    }
 
-        renderer2D->SetDrawColor(Colors::Black);
-        renderer2D->DrawTriangle(projected);
+    // every level's sorters and visibility are there before an instance first switches to it
+    if (depthMode == DepthMode::DepthBuffer) {
+        for (size_t level = 0; level < levels.size(); level++) {
+            size_t triangleCount = levels[level].mesh->GetTriangleCount() * instances.size();
+            triangleCount = std::bit_ceil(triangleCount + triangleCount / clipHeadroomDivisor);
+            GetSorter(levels[level].mesh, 0).Reserve(triangleCount);
+            if (occlusionCulling) GetSorter(levels[level].mesh, 1).Reserve(triangleCount);
+        }
+    }
+    if (depthMode == DepthMode::DepthBuffer && occlusionCulling) {
+        for (const Instance& instance : instances) {
+            if (instance.id == noInstanceId) continue;
+            for (size_t level = levels.size(); level-- > 0;) ReserveClusterVisibility(instance.id, level, levels[level].clusters->size());
+        }
+    }
+
+    FrameVector<Instance> levelInstances;
+    levelInstances.reserve(instances.size());
+    for (size_t level = 0; level < levels.size(); level++) {
+        if (levelCounts[level] == 0) continue;
+
+        levelInstances.clear();
+        for (size_t instance = 0; instance < instances.size(); instance++) {
+            if (instanceLevel[instance] == level) levelInstances.push_back(instances[instance]);
+        }
+        const LevelOfDetail& levelOfDetail = levels[level];
+        RenderLevel(*levelOfDetail.mesh, *levelOfDetail.clusters, levelInstances, projectionMatrix, cameraPosition,
+                    levelOfDetail.clusterTree, level);
     }
-}
\ No newline at end of file
+}
@@ -2,9 +2,19 @@
 #define RENDERER3D_H
 
 #include <vector>
+#include <span>
 #include <stdint.h>
 #include "../Renderer2D/Renderer2D.h"
+#include "../TileRenderer/TileRenderer.h"
+#include "../FrustumClipper/FrustumClipper.h"
+#include "../HierarchicalZ/HierarchicalZBuffer.h"
+#include "../DepthSorter/DepthSorter.h"
+#include "../../Engine/FrameArena/FrameArena.h"
 #include "../../Core/Geometry/Polygon.h"
+#include "../../Core/Geometry/Material.h"
+#include "../../Core/Geometry/TriangleCluster.h"
+#include "../../Core/Geometry/BoundingVolumeHierarchy.h"
+#include "../../Core/Geometry/Mesh.h"
 #include "../../Core/Math/Matrix.h"
 
 
@@ -13,15 +23,109 @@ class Renderer3D {
     using Triangle3D = Polygon3D<float, 3>;
     using Color3 = Vector<uint8_t, 3>;
     using Color4 = Vector<uint8_t, 4>;
+    using Cluster = TriangleCluster<float>;
+    using ClusterTree = BoundingVolumeHierarchy<float>;
+    using MeshType = Mesh<float>;
 
     public:
+        // PainterSort draws back to front by average z, DepthBuffer tests every pixel and draws front to back
+        enum class DepthMode { PainterSort, DepthBuffer };
+
+        struct RenderStats {
+            size_t trianglesSubmitted = 0;
+            size_t clustersFrustumCulled = 0;       // outside the frustum, never transformed
+            size_t trianglesFrustumCulled = 0;
+            size_t clustersBackfaceCulled = 0;      // every triangle faces away, never transformed
+            size_t trianglesBackfaceCulled = 0;
+            size_t trianglesSimplified = 0;         // full resolution triangles replaced by coarser levels of detail
+            size_t verticesTransformed = 0;         // matrix multiplies and divides, at most once per distinct position
+            size_t trianglesOutsideFrustum = 0;    // rejected before the perspective divide
+            size_t trianglesClipped = 0;            // crossed the near/far plane or the guard band
+            size_t trianglesCulled = 0;             // back faces
+            size_t trianglesRasterized = 0;
+            size_t clustersTested = 0;              // against the depth pyramid
+            size_t clustersOccluded = 0;
+            size_t trianglesOccluded = 0;           // in occluded clusters, never transformed
+            uint64_t pixelsShaded = 0;
+            uint64_t pixelsRejected = 0;
+            float overdraw = 0.0f;      // shaded pixels per window pixel
+        };
+
+        static constexpr uint32_t noInstanceId = UINT32_MAX;
+
+        // One placed copy of a mesh. Copies of the same mesh share its vertices, clusters and scratch buffers
+        struct Instance {
+            Matrix<float, 4, 4> transformationMatrix;
+            const Material<float>* material = nullptr;     // nullptr fills with SetMaterial's color
+            uint32_t id = noInstanceId;     // stable across frames, keeps its level of detail. Small, it indexes an array
+        };
+
+        // one resolution of a mesh, see MeshRegistry::Level
+        struct LevelOfDetail {
+            const MeshType* mesh;
+            const std::vector<Cluster>* clusters;
+            const ClusterTree* clusterTree = nullptr;
+        };
+
+        // One view's triangles after transform, clipping, culling and sorting, batch by batch as they went to
+        // the rasterizer. Another Renderer3D showing the same view draws it with Rasterize instead of doing all
+        // of that again. Plain vectors: the buffers are kept from frame to frame and other threads read them
+        struct DrawList {
+            struct Batch {
+                size_t first, count;    // into triangles, colors and drawOrder, whose indices count from first
+                bool depthTesting;
+            };
+
+            std::vector<Triangle3D> triangles;
+            std::vector<Color3> colors;
+            std::vector<uint32_t> drawOrder;
+            std::vector<Batch> batches;
+            RenderStats stats;      // the recorder's, pixel counts are each window's own
+            const Renderer3D* recorder = nullptr;
+            bool rasterizedByRecorder = false;  // occlusion culling needs its own depth while it draws
+        };
 
         Renderer3D(Renderer2D* renderer2D, float windowWidth, float windowHeight) : renderer2D(renderer2D),
                                                                                     windowWidth(windowWidth),
-                                                                                    windowHeight(windowHeight){};
+                                                                                    windowHeight(windowHeight){
+            clipper.SetViewport(windowWidth, windowHeight);
+        };
 
+        // plain triangle list, indexed into a temporary mesh on every call
         void Render(const std::vector<Triangle3D> &triangles, const Matrix<float, 4, 4> &viewProjectionMatrix, 
             const Matrix<float, 4, 4> &projectionMatrix, const Vector<float, 3>& cameraPosition);
+        // Clusters partition the mesh's triangles into culling units, see BuildTriangleClusters.
+        // Scratch data comes from the FrameArena, the caller resets it once the frame is presented.
+        // With painter's sort nothing is drawn before Flush(): the triangles of every Render call since Clear() are
+        // sorted back to front together, so instances of different meshes overlap in the right order
+        void Render(const MeshType& mesh, const std::vector<Cluster>& clusters,
+            const Matrix<float, 4, 4> &transformationMatrix, const Matrix<float, 4, 4> &projectionMatrix,
+            const Vector<float, 3>& cameraPosition);
+        // Every copy of the mesh in one pass: their triangles are transformed, sorted and drawn together.
+        // Clusters outside the frustum or facing away from the camera are dropped before any of their vertices
+        // are transformed. The frustum goes through clusterTree when there is one (built over the clusters'
+        // boxes), else one box test per cluster, facing away is one normal cone test per cluster.
+        // Stats add up over all Render calls since the last Clear()
+        void Render(const MeshType& mesh, const std::vector<Cluster>& clusters, std::span<const Instance> instances,
+            const Matrix<float, 4, 4> &projectionMatrix, const Vector<float, 3>& cameraPosition,
+            const ClusterTree* clusterTree = nullptr);
+        // Levels go from finest to coarsest. Each instance gets the finest level with no more triangles than
+        // the pixels covered by levels[0]'s bounds divided by SetLevelOfDetailDensity, and keeps its last level
+        // until its size is levelHysteresis past either threshold so it doesn't flicker between two.
+        // Every level's instances go through one Render call, finest (usually nearest) first for the depth buffer,
+        // painter's sort orders all levels together with the rest of the frame.
+        // Without a cluster tree on levels[0] there are no bounds to measure and everything gets levels[0]
+        void Render(std::span<const LevelOfDetail> levels, std::span<const Instance> instances,
+            const Matrix<float, 4, 4> &projectionMatrix, const Vector<float, 3>& cameraPosition);
+        // Render calls between these go into drawList as well. Unless occlusion culling needs the depth they
+        // leave, they don't draw anything themselves, the recorder then draws with Rasterize like everyone else.
+        // Both flush first: earlier triangles are drawn, recorded ones go into the list as one painter's sort batch
+        void BeginRecording(DrawList& drawList);
+        void EndRecording();
+        // Draws a list recorded for a view of the same size, on any thread as long as the Renderer2D renders into
+        // its framebuffer. Clear() first, stats become the recorder's with this window's pixel counts
+        void Rasterize(const DrawList& drawList);
+
         void SetDrawColor(const Color3& color) {
             renderer2D->SetDrawColor(color);
         }
@@ -29,18 +133,135 @@ class Renderer3D {
         void SetDrawColor(const Color4& color) {
             renderer2D->SetDrawColor(color);
         }
+        // sorts and draws the frame's painter's sort triangles, nothing to do with the depth buffer
+        void Flush();
         void Present(){
+            Flush();
             renderer2D->Present();
         };
-        void Clear(){
-            renderer2D->Clear();
-        };
+        // starts a frame: color, depth, stats
+        void Clear();
         void SetWindowDimensions(float width, float height);
+        // view distances of the near and far planes the projection matrix was built with
+        void SetClipPlanes(float nearPlane, float farPlane) { clipper.SetPlanes(nearPlane, farPlane); }
+
+        void SetDepthMode(DepthMode mode) { depthMode = mode; }
+        DepthMode GetDepthMode() const { return depthMode; }
+        void SetFrontToBackSorting(bool enabled) { frontToBackSorting = enabled; }
+        // start each frame's sort from the last frame's order, cheap while the view barely moves
+        void SetTemporalSorting(bool enabled) {
+            temporalSorting = enabled;
+            for (BatchSorter& batchSorter : depthSorters) batchSorter.sorter.SetTemporalCoherence(enabled);
+        }
+
+        // only takes effect with the framebuffer backend, SDL draw calls have to stay on this thread
+        void SetTiledRasterization(bool enabled) { tiledRasterization = enabled; }
+        bool GetTiledRasterization() const { return tiledRasterization; }
+
+        // With the SDL backend and painter's sort the whole frame goes out as one SDL_RenderGeometry call,
+        // SDL can't depth test so depth buffer mode keeps the span path. Outlines go into the same call as thin quads
+        void SetBatchedGeometry(bool enabled) { batchedGeometry = enabled; }
+        bool GetBatchedGeometry() const { return batchedGeometry; }
+        void SetBatchedOutlines(bool enabled) { batchedOutlines = enabled; }
+
+        // Hierarchical-Z occlusion culling of clusters, only in depth buffer mode
+        void SetOcclusionCulling(bool enabled) { occlusionCulling = enabled; }
+        bool GetOcclusionCulling() const { return occlusionCulling; }
+
+        // fill color comes from the material's diffuse color
+        void SetMaterial(const Material<float>& material);
+
+        // screen pixels per triangle the chosen level of detail may not go below
+        void SetLevelOfDetailDensity(float pixelsPerTriangle) { levelPixelsPerTriangle = pixelsPerTriangle; }
+        float GetLevelOfDetailDensity() const { return levelPixelsPerTriangle; }
+
+        const RenderStats& GetStats() const { return stats; }
 
     private:
         Renderer2D* renderer2D;
         float windowWidth;
         float windowHeight;
+
+        DepthMode depthMode = DepthMode::PainterSort;
+        bool frontToBackSorting = true;     // only used with the depth buffer, cuts overdraw
+        bool tiledRasterization = true;
+        bool batchedGeometry = true;
+        bool batchedOutlines = true;
+        bool occlusionCulling = true;
+        Color3 fillColor = Color3(255, 255, 255), outlineColor = Color3(0, 0, 0);
+        TileRenderer tileRenderer;
+        FrustumClipper clipper;
+        RenderStats stats;
+
+        HierarchicalZBuffer hierarchicalZ;
+        // by Instance::id, level of detail and cluster, whether the depth the instance's last draw at that level
+        // left didn't hide it. Instances without an id have no last frame, all their clusters count as visible
+        std::vector<std::vector<std::vector<uint8_t>>> clusterVisible;
+
+        static constexpr float levelHysteresis = 0.25f;
+        float levelPixelsPerTriangle = 16.0f;
+        std::vector<uint8_t> instanceLevels;    // by Instance::id, the level each was last drawn at
+
+        // a clipped triangle comes out as up to 7 pieces, buffers make room for one extra per this many triangles
+        static constexpr size_t clipHeadroomDivisor = 4;
+
+        DrawList* recording = nullptr;
+        DrawList frameList;         // painter's sort triangles waiting for Flush while nothing is recorded
+        size_t pendingFirst = 0;    // where they start in the list being recorded or frameList
+        std::vector<uint64_t> pendingIds;   // theirs, see TransformTriangles
+
+        // One sorter per batch so each keeps its own last frame's order: a mesh's occlusion pass with the
+        // depth buffer, the whole frame (mesh nullptr) with painter's sort. These buffers outlive the frame,
+        // all other per-frame scratch comes from the FrameArena
+        struct BatchSorter {
+            const MeshType* mesh;
+            int pass;
+            DepthSorter sorter;
+        };
+        std::vector<BatchSorter> depthSorters;
+        bool temporalSorting = true;
+        std::vector<float> triangleDepths;
+        std::vector<uint32_t> submissionOrder;
+
+        // Per draw transform state: the model-view-projection matrix, combined once, and the post-transform
+        // vertex cache, each mesh vertex goes through the matrix and the divide the first time a triangle needs it
+        struct TransformStage {
+            Matrix<float, 4, 4> clipMatrix;
+            Vector<float, 3> cameraPosition;
+            FrameVector<FrustumClipper::TransformedVertex> vertexCache;
+            FrameVector<uint8_t> vertexCached;
+            size_t cachedInstance = SIZE_MAX;   // whose vertices vertexCache holds
+        };
+
+        static uint32_t PackColor(const Color3& color);
+        static Color3 GetFillColor(const Material<float>& material);
+        Triangle2D ToScreenSpace(const Triangle3D& transformed) const;
+        static std::array<float, 3> GetDepths(const Triangle3D& transformed);
+        void ReserveScratch(const MeshType& mesh, size_t triangleCount, bool depthTesting);
+        DepthSorter& GetSorter(const MeshType* mesh, int pass);
+        void RenderBatched(std::span<const Triangle3D> transformedTriangles, std::span<const Color3> triangleColors,
+            std::span<const uint32_t> drawOrder);
+        void TransformVertexStreams(const MeshType& mesh, TransformStage& stage);
+        void CollectVisibleClusters(const std::vector<Cluster>& clusters, const ClusterTree* clusterTree,
+            const Matrix<float, 4, 4>& clipMatrix, FrameVector<uint32_t>& output);
+        void RenderLevel(const MeshType& mesh, const std::vector<Cluster>& clusters, std::span<const Instance> instances,
+            const Matrix<float, 4, 4> &projectionMatrix, const Vector<float, 3>& cameraPosition,
+            const ClusterTree* clusterTree, size_t level);
+        void ReserveClusterVisibility(uint32_t id, size_t level, size_t clusterCount);
+        void SelectInstance(const MeshType& mesh, size_t instance, const Matrix<float, 4, 4>& clipMatrix,
+            bool transformAll, TransformStage& stage);
+        void TransformTriangles(const MeshType& mesh, size_t first, size_t count, uint64_t instanceKey,
+            TransformStage& stage, FrameVector<Triangle3D>& output, FrameVector<uint64_t>& outputIds);
+        void RasterizeTriangles(const FrameVector<Triangle3D>& transformedTriangles, const FrameVector<Color3>& triangleColors,
+            const FrameVector<uint64_t>& triangleIds, bool depthTesting, const MeshType& mesh, int pass);
+        const std::vector<uint32_t>& SortTriangles(std::span<const Triangle3D> transformedTriangles,
+            std::span<const uint64_t> triangleIds, bool depthTesting, DepthSorter& sorter);
+        void DrawTriangles(std::span<const Triangle3D> transformedTriangles, std::span<const Color3> triangleColors,
+            std::span<const uint32_t> drawOrder, bool depthTesting);
+        void UpdatePixelStats();
+        size_t SelectLevel(std::span<const LevelOfDetail> levels, const Instance& instance,
+            const Matrix<float, 4, 4>& projectionMatrix);
+        bool IsClusterOccluded(const Cluster& cluster, const Matrix<float, 4, 4>& clipMatrix) const;
 };
 
 
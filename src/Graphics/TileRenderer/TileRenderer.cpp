@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <functional>
+#include <math.h>
+#include "TileRenderer.h"
+#include "../../Engine/ThreadPool/ThreadPool.h"
+#include "../../Engine/Profiler/Profiler.h"
+
+
+void TileRenderer::Render(const FrameVector<RasterTriangle>& triangles, Framebuffer& framebuffer, DepthBuffer* depthBuffer, RasterStats& stats) {
+    PROFILE_FUNCTION();
+    Bins bins;
+    BinTriangles(triangles, framebuffer.GetWidth(), framebuffer.GetHeight(), bins);
+
+    ThreadPool& threadPool = ThreadPool::GetInstance();
+    workerStats.assign(threadPool.GetWorkerCount(), RasterStats());
+
+    auto renderTile = [&](size_t tileIndex, size_t workerIndex) {
+        RenderTile(tileIndex, triangles, bins, framebuffer, depthBuffer, workerStats[workerIndex]);
+    };
+    // through std::ref the job doesn't copy the lambda's captures to the heap
+    threadPool.ParallelFor(size_t(tilesX) * tilesY, std::ref(renderTile));
+
+    for(const RasterStats& worker : workerStats) stats += worker;
+}
+
+
+// false when the triangle can't touch the window
+bool TileRenderer::GetTileRange(const RasterTriangle& triangle, int width, int height, int& firstTileX, int& firstTileY,
+                                int& lastTileX, int& lastTileY) {
+    const auto& vertices = triangle.screen.vertices;
+    float minX = std::min({vertices[0][0], vertices[1][0], vertices[2][0]});
+    float maxX = std::max({vertices[0][0], vertices[1][0], vertices[2][0]});
+    float minY = std::min({vertices[0][1], vertices[1][1], vertices[2][1]});
+    float maxY = std::max({vertices[0][1], vertices[1][1], vertices[2][1]});
+
+    // written this way round so NaN coordinates get rejected too
+    if(!(maxX >= -1.0f && maxY >= -1.0f && minX <= width && minY <= height)) return false;
+
+    // spans and outline pixels are rounded, so a pixel of slack on each side keeps the bins conservative
+    firstTileX = static_cast<int>(std::max(std::floor(minX) - 1.0f, 0.0f)) / tileSize;
+    firstTileY = static_cast<int>(std::max(std::floor(minY) - 1.0f, 0.0f)) / tileSize;
+    lastTileX = static_cast<int>(std::min(std::ceil(maxX) + 1.0f, float(width - 1))) / tileSize;
+    lastTileY = static_cast<int>(std::min(std::ceil(maxY) + 1.0f, float(height - 1))) / tileSize;
+    return true;
+}
+
+// Counting sort into tiles: one pass sizes the bins, a second one fills them in submission order
+void TileRenderer::BinTriangles(const FrameVector<RasterTriangle>& triangles, int width, int height, Bins& bins) {
+    tilesX = (width + tileSize - 1) / tileSize;
+    tilesY = (height + tileSize - 1) / tileSize;
+    size_t tileCount = size_t(tilesX) * tilesY;
+    bins.starts.assign(tileCount + 1, 0);
+
+    int firstTileX, firstTileY, lastTileX, lastTileY;
+    for(const RasterTriangle& triangle : triangles){
+        if(!GetTileRange(triangle, width, height, firstTileX, firstTileY, lastTileX, lastTileY)) continue;
+        for(int tileY = firstTileY; tileY <= lastTileY; tileY++){
+            for(int tileX = firstTileX; tileX <= lastTileX; tileX++) bins.starts[tileY * tilesX + tileX + 1]++;
+        }
+    }
+    for(size_t tile = 0; tile < tileCount; tile++) bins.starts[tile + 1] += bins.starts[tile];
+
+    // starts[i] serves as tile i's write cursor and ends up where tile i + 1 starts, shifted back below
+    bins.triangles.resize(bins.starts[tileCount]);
+    for(uint32_t i = 0; i < triangles.size(); i++){
+        if(!GetTileRange(triangles[i], width, height, firstTileX, firstTileY, lastTileX, lastTileY)) continue;
+        for(int tileY = firstTileY; tileY <= lastTileY; tileY++){
+            for(int tileX = firstTileX; tileX <= lastTileX; tileX++) bins.triangles[bins.starts[tileY * tilesX + tileX]++] = i;
+        }
+    }
+    for(size_t tile = tileCount; tile > 0; tile--) bins.starts[tile] = bins.starts[tile - 1];
+    bins.starts[0] = 0;
+}
+
+
+void TileRenderer::RenderTile(int tileIndex, const FrameVector<RasterTriangle>& triangles, const Bins& bins, Framebuffer& framebuffer,
+                              DepthBuffer* depthBuffer, RasterStats& stats) const {
+    uint32_t binStart = bins.starts[tileIndex], binEnd = bins.starts[tileIndex + 1];
+    if(binStart == binEnd) return;
+
+    int tileX = tileIndex % tilesX, tileY = tileIndex / tilesX;
+    ClipRect clip = {
+        tileX * tileSize,
+        tileY * tileSize,
+        std::min((tileX + 1) * tileSize, framebuffer.GetWidth()) - 1,
+        std::min((tileY + 1) * tileSize, framebuffer.GetHeight()) - 1
+    };
+
+    Rasterizer rasterizer(&framebuffer, depthBuffer, clip);
+    for(uint32_t i = binStart; i < binEnd; i++){
+        const RasterTriangle& triangle = triangles[bins.triangles[i]];
+        rasterizer.SetColor(triangle.fillColor);
+        if(depthBuffer) rasterizer.FillTriangle(triangle.screen, triangle.depths);
+        else rasterizer.FillTriangle(triangle.screen);
+
+        rasterizer.SetColor(triangle.outlineColor);
+        if(depthBuffer) rasterizer.DrawTriangle(triangle.screen, triangle.depths);
+        else rasterizer.DrawTriangle(triangle.screen);
+    }
+    stats += rasterizer.stats;
+}
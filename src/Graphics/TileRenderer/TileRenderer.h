@@ -0,0 +1,40 @@
+#ifndef TILE_RENDERER_H
+#define TILE_RENDERER_H
+
+#include <vector>
+#include <stdint.h>
+#include "../Rasterizer/Rasterizer.h"
+#include "../Framebuffer/Framebuffer.h"
+#include "../Framebuffer/DepthBuffer.h"
+#include "../../Engine/FrameArena/FrameArena.h"
+
+
+// Sort-middle parallel rasterizer: triangles are binned into screen tiles, then every tile is rasterized
+// by a single ThreadPool worker, so the shared framebuffer needs no locks.
+// Triangles keep their submission order inside each tile, which makes the image identical to a single threaded pass
+class TileRenderer {
+    public:
+        static constexpr int tileSize = 64;     // 64 pixels = 256 bytes per tile row, tiles never share a cache line
+
+        // Fills and outlines every triangle; depth tested when depthBuffer isn't null. Counters are added to stats
+        void Render(const FrameVector<RasterTriangle>& triangles, Framebuffer& framebuffer, DepthBuffer* depthBuffer, RasterStats& stats);
+
+    private:
+        int tilesX = 0, tilesY = 0;
+        std::vector<RasterStats> workerStats;
+
+        // Triangle indices of every tile in one flat array from the frame arena,
+        // tile i's are triangles[starts[i], starts[i + 1])
+        struct Bins {
+            FrameVector<uint32_t> starts;
+            FrameVector<uint32_t> triangles;
+        };
+
+        static bool GetTileRange(const RasterTriangle& triangle, int width, int height, int& firstTileX, int& firstTileY,
+                                 int& lastTileX, int& lastTileY);
+        void BinTriangles(const FrameVector<RasterTriangle>& triangles, int width, int height, Bins& bins);
+        void RenderTile(int tileIndex, const FrameVector<RasterTriangle>& triangles, const Bins& bins, Framebuffer& framebuffer,
+                        DepthBuffer* depthBuffer, RasterStats& stats) const;
+};
+
+#endif
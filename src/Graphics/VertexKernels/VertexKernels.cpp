@@ -0,0 +1,89 @@
+#include "VertexKernels.h"
+#include "../Rasterizer/TriangleKernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define VERTEX_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+
+namespace VertexKernels {
+namespace {
+
+    // multiply then add in column order, no fused multiply-add, so every path matches the scalar Vector * Matrix
+    void TransformScalar(const float* x, const float* y, const float* z, size_t first, size_t count, const float* m,
+                         float* outX, float* outY, float* outZ, float* outW) {
+        for (size_t i = first; i < count; i++) {
+            outX[i] = 0.0f + m[0] * x[i] + m[1] * y[i] + m[2] * z[i] + m[3];
+            outY[i] = 0.0f + m[4] * x[i] + m[5] * y[i] + m[6] * z[i] + m[7];
+            outZ[i] = 0.0f + m[8] * x[i] + m[9] * y[i] + m[10] * z[i] + m[11];
+            outW[i] = 0.0f + m[12] * x[i] + m[13] * y[i] + m[14] * z[i] + m[15];
+        }
+    }
+
+#ifdef VERTEX_KERNELS_X86
+
+    // returns how many vertices it did, the scalar loop finishes the rest
+    size_t TransformSSE2(const float* x, const float* y, const float* z, size_t count, const float* m,
+                         float* outX, float* outY, float* outZ, float* outW) {
+        float* outputs[4] = { outX, outY, outZ, outW };
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i);
+            for (int row = 0; row < 4; row++) {
+                const float* r = m + row * 4;
+                __m128 sum = _mm_add_ps(_mm_setzero_ps(), _mm_mul_ps(_mm_set1_ps(r[0]), vx));
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(r[1]), vy));
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(r[2]), vz));
+                sum = _mm_add_ps(sum, _mm_set1_ps(r[3]));
+                _mm_storeu_ps(outputs[row] + i, sum);
+            }
+        }
+        return i;
+    }
+
+    TARGET_AVX2 size_t TransformAVX2(const float* x, const float* y, const float* z, size_t count, const float* m,
+                                     float* outX, float* outY, float* outZ, float* outW) {
+        float* outputs[4] = { outX, outY, outZ, outW };
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+            for (int row = 0; row < 4; row++) {
+                const float* r = m + row * 4;
+                __m256 sum = _mm256_add_ps(_mm256_setzero_ps(), _mm256_mul_ps(_mm256_set1_ps(r[0]), vx));
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(r[1]), vy));
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(r[2]), vz));
+                sum = _mm256_add_ps(sum, _mm256_set1_ps(r[3]));
+                _mm256_storeu_ps(outputs[row] + i, sum);
+            }
+        }
+        return i;
+    }
+
+#endif
+
+}
+
+
+void TransformPositions(const float* x, const float* y, const float* z, size_t count, const Matrix<float, 4, 4>& matrix,
+                        float* outX, float* outY, float* outZ, float* outW) {
+    const float* m = matrix.elements.data();
+    size_t done = 0;
+
+#ifdef VERTEX_KERNELS_X86
+    using TriangleKernels::InstructionSet;
+    InstructionSet instructionSet = TriangleKernels::GetInstructionSet();
+    if (instructionSet == InstructionSet::AVX2) done = TransformAVX2(x, y, z, count, m, outX, outY, outZ, outW);
+    if (instructionSet == InstructionSet::SSE2) done = TransformSSE2(x, y, z, count, m, outX, outY, outZ, outW);
+#endif
+
+    TransformScalar(x, y, z, done, count, m, outX, outY, outZ, outW);
+}
+
+}
@@ -0,0 +1,18 @@
+#ifndef VERTEX_KERNELS_H
+#define VERTEX_KERNELS_H
+
+#include <stddef.h>
+#include "../../Core/Math/Matrix.h"
+
+
+// Passes over structure of arrays vertex streams, 8 vertices per step with AVX2 or 4 with SSE2.
+// Follow TriangleKernels::GetInstructionSet(), so F5 switches these too
+namespace VertexKernels {
+
+    // (outX, outY, outZ, outW) = matrix * (x, y, z, 1) for count vertices, rounded exactly like Vector * Matrix.
+    // Streams don't have to be aligned
+    void TransformPositions(const float* x, const float* y, const float* z, size_t count, const Matrix<float, 4, 4>& matrix,
+                            float* outX, float* outY, float* outZ, float* outW);
+}
+
+#endif
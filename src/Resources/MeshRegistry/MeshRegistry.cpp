@@ -0,0 +1,60 @@
+#include <utility>
+#include "MeshRegistry.h"
+#include "../ModelLoader/ModelLoader.h"
+#include "../../Core/Geometry/MeshSimplifier.h"
+#include "../../Engine/Profiler/Profiler.h"
+
+
+MeshRegistry::MeshHandle MeshRegistry::Load(const std::string& path, bool levelsOfDetail) {
+    auto found = handlesByPath.find(path);
+    if (found != handlesByPath.end()) {
+        if (levelsOfDetail) BuildLevelsOfDetail(entries[found->second]);
+        return found->second;
+    }
+
+    ModelLoader<float> modelLoader;
+    if (!modelLoader.LoadFromObj(path)) return noMesh;
+
+    // the loader already triangulated and indexed everything, nothing else needs its copy
+    Entry entry;
+    entry.path = path;
+    entry.levels.emplace_back();
+    entry.levels[0].mesh = std::move(modelLoader.mesh);
+    BuildLevel(entry.levels[0]);
+    entry.materials = std::move(modelLoader.materials);
+    if (levelsOfDetail) BuildLevelsOfDetail(entry);
+
+    MeshHandle handle = static_cast<MeshHandle>(entries.size());
+    entries.push_back(std::move(entry));
+    handlesByPath.emplace(path, handle);
+    return handle;
+}
+
+void MeshRegistry::BuildLevel(Level& level) {
+    PROFILE_FUNCTION();
+    level.mesh.BuildVertexStreams();
+    // reorders the triangles so each meshlet is a run of them
+    level.clusters = BuildMeshlets(level.mesh);
+
+    std::vector<BoundingVolumeHierarchy<float>::Box> clusterBoxes;
+    clusterBoxes.reserve(level.clusters.size());
+    for (const TriangleCluster<float>& cluster : level.clusters) clusterBoxes.push_back({ cluster.boundsMin, cluster.boundsMax });
+    level.clusterTree.Build(clusterBoxes);
+}
+
+// Each level is simplified from the one before. Stops early once a level barely gets smaller,
+// whatever is left can't collapse without turning faces over
+void MeshRegistry::BuildLevelsOfDetail(Entry& entry) {
+    PROFILE_FUNCTION();
+    while (entry.levels.size() < maximumLevels) {
+        size_t triangleCount = entry.levels.back().mesh.GetTriangleCount();
+        if (triangleCount <= minimumLevelTriangles) return;
+
+        Level level;
+        level.mesh = SimplifyMesh(entry.levels.back().mesh, triangleCount / 2);
+        if (level.mesh.GetTriangleCount() * 10 > triangleCount * 9) return;
+
+        BuildLevel(level);
+        entry.levels.push_back(std::move(level));
+    }
+}
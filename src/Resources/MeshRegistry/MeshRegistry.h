@@ -0,0 +1,52 @@
+#ifndef MESH_REGISTRY_H
+#define MESH_REGISTRY_H
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <stdint.h>
+#include "../../Core/Geometry/Mesh.h"
+#include "../../Core/Geometry/Material.h"
+#include "../../Core/Geometry/TriangleCluster.h"
+#include "../../Core/Geometry/BoundingVolumeHierarchy.h"
+
+
+// Every model file is loaded once and everything placing it refers to it by handle,
+// so a thousand copies of a model cost a thousand handles, not a thousand meshes
+class MeshRegistry {
+    public:
+        using MeshHandle = uint32_t;
+        static constexpr MeshHandle noMesh = UINT32_MAX;
+
+        // one resolution of the mesh and everything derived from it that doesn't depend on where it's placed
+        struct Level {
+            Mesh<float> mesh;
+            std::vector<TriangleCluster<float>> clusters;
+            BoundingVolumeHierarchy<float> clusterTree;     // over the clusters' boxes, its bounds are the mesh's
+        };
+
+        struct Entry {
+            std::string path;
+            std::vector<Level> levels;      // [0] is the file as loaded, each one after has about half the triangles
+            std::vector<Material<float>> materials;
+        };
+
+        // Loading a path a second time returns the first handle, noMesh if the file couldn't be loaded.
+        // levelsOfDetail adds simplified levels down to minimumLevelTriangles, also to a mesh loaded without them
+        MeshHandle Load(const std::string& path, bool levelsOfDetail = false);
+
+        const Entry& Get(MeshHandle handle) const { return entries[handle]; }
+        size_t GetMeshCount() const { return entries.size(); }
+
+        static constexpr size_t minimumLevelTriangles = 64;
+        static constexpr size_t maximumLevels = 8;
+
+    private:
+        static void BuildLevel(Level& level);
+        static void BuildLevelsOfDetail(Entry& entry);
+
+        std::vector<Entry> entries;
+        std::unordered_map<std::string, MeshHandle> handlesByPath;
+};
+
+#endif
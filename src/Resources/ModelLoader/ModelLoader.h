@@ -6,37 +6,69 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <unordered_map>
+#include <stdint.h>
 
 #include "../../Core/Geometry/Material.h"
 #include "../../Core/Geometry/Model.h"
+#include "../../Core/Geometry/Mesh.h"
+#include "../../Core/Utilities/MathFunctions.h"
 #include "../../Core/Utilities/StringFunctions.h"
 #include "../../Core/Utilities/OutputFunctions.h"
+#include "../../Engine/Profiler/Profiler.h"
 
 
 
 template <typename ComponentType>
 class ModelLoader {
     private:
-        using Triangle3 = Polygon3D<ComponentType, 3>;
-        using Quadrilateral = Polygon3D<ComponentType, 4>;
-        using NGon = NGon3D<ComponentType>;
-
         using VertexType = Vertex3<ComponentType>;
+        using MeshType = Mesh<ComponentType>;
         using ModelType = Model<ComponentType>;
         using MaterialType = Material<ComponentType>;
         using Vector3 = Vector<ComponentType, 3>;
         using Vector2 = Vector<ComponentType, 2>;
 
+        // a face corner as the file wrote it, v/vt/vn indices with -1 for missing ones
+        struct CornerKey {
+            int position, textureCoordinates, normal;
+            bool operator==(const CornerKey& other) const {
+                return position == other.position && textureCoordinates == other.textureCoordinates && normal == other.normal;
+            }
+        };
+        struct CornerKeyHash {
+            size_t operator()(const CornerKey& key) const {
+                return (size_t(uint32_t(key.position)) * 0x9E3779B1u) ^ (size_t(uint32_t(key.textureCoordinates)) << 21) ^ (size_t(uint32_t(key.normal)) << 42);
+            }
+        };
+
+        // what Triangulate needs from a vertex, plus where it went in the mesh
+        struct IndexedCorner {
+            Vector3 position;
+            uint32_t index;
+        };
+
+        void AddFace(const std::vector<IndexedCorner>& corners) {
+            if (corners.size() == 3) {
+                for (const IndexedCorner& corner : corners) mesh.indices.push_back(corner.index);
+                return;
+            }
+            Vector3 normal = ((corners[1].position - corners[0].position) % (corners[2].position - corners[0].position)).Unit();
+            auto triangles = MathFunctions::Polygons::Triangulate<ComponentType, std::vector<IndexedCorner>>(corners, normal);
+            for (const auto& triangle : triangles) {
+                for (const IndexedCorner& corner : triangle) mesh.indices.push_back(corner.index);
+            }
+        }
+
     public:
         std::vector<ModelType> models;
         std::vector<MaterialType> materials;
-        std::vector<Triangle3> triangles;
-        std::vector<Quadrilateral> quadrilaterals;
-        std::vector<NGon> ngons;
+        MeshType mesh;      // every face triangulated, corners the file repeats share a vertex
         
         ModelLoader(){};
 
         bool LoadFromObj(std::string filepath) {
+            PROFILE_FUNCTION();
             if (EndsWith(filepath, ".obj") == false) {
                 std::cout << "Error: File is not a .obj file." << std::endl;
                 return false;
@@ -49,12 +81,13 @@ class ModelLoader {
                 return false;
             }
 
-            triangles.clear();
+            mesh = MeshType();
             models.clear();
             materials.clear();
 
             std::vector<Vector3> verticePositions, verticeNormals;
             std::vector<Vector2> verticeTextureCoordinates;
+            std::unordered_map<CornerKey, uint32_t, CornerKeyHash> cornerVertices;
             
             std::string line;
             while (std::getline(file, line)) {
@@ -122,41 +155,32 @@ class ModelLoader {
                 }
                 else if(lineWords[0] == "f") {
                     size_t vertexCount = lineWords.size() - 1;
-                    VertexType polygonVertices[vertexCount];
+                    if(vertexCount < 3) continue;
+                    std::vector<IndexedCorner> corners(vertexCount);
                     for(int i=1; i <= vertexCount; i++) {
                         std::vector<std::string> faceWords = Split(lineWords[i], "/");
-                        polygonVertices[i-1].position = verticePositions[std::stoi(faceWords[0]) - 1];
-                        if(faceWords.size() < 2) continue;
+                        CornerKey key = { std::stoi(faceWords[0]) - 1, -1, -1 };
                         if(faceWords.size() == 2 or
                         (faceWords.size() == 3 and faceWords[1].empty() == false)){
-                            polygonVertices[i-1].textureCoordinates = verticeTextureCoordinates[std::stoi(faceWords[1]) - 1];
+                            key.textureCoordinates = std::stoi(faceWords[1]) - 1;
                         }
-                        if(faceWords.size() < 3) continue;
-                        polygonVertices[i-1].normal = verticeNormals[std::stoi(faceWords[2]) - 1];
-                    }
-                    switch(vertexCount){
-                        case 3: triangles.push_back(Triangle3(polygonVertices)); break;
-                        case 4: quadrilaterals.push_back(Quadrilateral(polygonVertices)); break;
-                        default:
-                            ngons.push_back(
-                                NGon(polygonVertices, vertexCount)
-                            );
-                            break;
+                        if(faceWords.size() >= 3) key.normal = std::stoi(faceWords[2]) - 1;
+
+                        auto inserted = cornerVertices.emplace(key, static_cast<uint32_t>(mesh.vertices.size()));
+                        if(inserted.second) {
+                            VertexType vertex;
+                            vertex.position = verticePositions[key.position];
+                            if(key.textureCoordinates >= 0) vertex.textureCoordinates = verticeTextureCoordinates[key.textureCoordinates];
+                            if(key.normal >= 0) vertex.normal = verticeNormals[key.normal];
+                            mesh.vertices.push_back(vertex);
+                        }
+                        corners[i-1] = { verticePositions[key.position], inserted.first->second };
                     }
+                    AddFace(corners);
                 }
             }
 
-            // for(int i=0; i < triangles.size(); i++) {
-            //     std::cout<<triangles[i]<<std::endl;
-            // }
-
-            // for(int i=0; i < quadrilaterals.size(); i++) {
-            //     std::cout<<quadrilaterals[i]<<std::endl;
-            // }
-
-            // for(int i=0; i < ngons.size(); i++) {
-            //     std::cout<<ngons[i]<<std::endl;
-            // }
+            mesh.IndexSharedPositions();
 
             file.close();
             return true;